@@ -0,0 +1,256 @@
+#include "attachpipeline.h"
+#include "sharedoffsets.h"
+#include "trace.h"
+
+AttachPipeline::AttachPipeline(size_t thread_count)
+	: pool(thread_count ? thread_count : 1)
+{
+	// a process that found another one scanning its build waits in Scan; it's stepped again as soon as that scan is over
+	SharedOffsets::SetListener([this]()
+	{
+		StepWaiting();
+	});
+}
+
+AttachPipeline::~AttachPipeline()
+{
+	SharedOffsets::SetListener(nullptr); // only our own steps publish, and WaitIdle waits those out
+	CancelAll();
+	WaitIdle();
+}
+
+size_t AttachPipeline::DefaultThreadCount()
+{
+	const size_t count = ThreadPool::DefaultThreadCount();
+	return count < 4 ? count : 4;
+}
+
+bool AttachPipeline::Contains(Id id, StartTime start_time)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	auto it = entries.find(id);
+	if (it == entries.end())
+		return false;
+
+	const StartTime known = it->second->start_time;
+	return known == start_time || known == 0 || start_time == 0;
+}
+
+size_t AttachPipeline::GetCount()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return entries.size();
+}
+
+void AttachPipeline::Add(Id id, StartTime start_time, std::unique_ptr<ProcUtil::MemorySource> source, RobloxHandleType type, int retry_count)
+{
+	auto entry = std::make_shared<Entry>();
+	entry->id = id;
+	entry->start_time = start_time;
+	entry->process.Begin(std::move(source), type, retry_count);
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	auto it = entries.find(id);
+	if (it != entries.end())
+		Erase(it); // the pid was reused before the old process was purged
+
+	entries[id] = entry;
+	Submit(entry);
+}
+
+void AttachPipeline::Remove(Id id)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	auto it = entries.find(id);
+	if (it != entries.end())
+		Erase(it);
+}
+
+void AttachPipeline::RemoveIf(const std::function<bool(Id id, StartTime start_time, RobloxProcess &process)> &is_dead)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (is_dead(it->first, it->second->start_time, it->second->process))
+			it = Erase(it);
+		else
+			it++;
+	}
+}
+
+// Called with `lock` held: cancels the process' current step, if any, and it's destroyed once that step returns
+AttachPipeline::EntryMap::iterator AttachPipeline::Erase(EntryMap::iterator it)
+{
+	it->second->process.Cancel();
+	scheduler.Cancel(it->first);
+	return entries.erase(it);
+}
+
+// Called with `lock` held
+void AttachPipeline::Submit(const std::shared_ptr<Entry> &entry)
+{
+	entry->busy = true;
+	busy_count++;
+
+	pool.Submit([this, entry]()
+	{
+		Run(entry, [](RobloxProcess &process) { process.Step(); });
+	});
+}
+
+// Called with `lock` held, once nothing is running for `entry`
+void AttachPipeline::Reschedule(const std::shared_ptr<Entry> &entry)
+{
+	auto it = entries.find(entry->id);
+	if (it == entries.end() || it->second != entry)
+		return; // removed meanwhile
+
+	if (entry->process.IsDone())
+		scheduler.Cancel(entry->id);
+	else
+		scheduler.Schedule(entry->id, entry->process.GetNextStepTime());
+}
+
+// Any thread, without `lock` held (called from the SharedOffsets listener, i.e. from inside another process' step)
+void AttachPipeline::StepWaiting()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	const auto now = Scheduler::Clock::now();
+
+	for (auto &it : entries)
+	{
+		// a busy process is rescheduled when it's done, at its own next_step
+		if (!it.second->busy && it.second->process.IsWaitingForSharedOffsets())
+			scheduler.Schedule(it.first, now);
+	}
+}
+
+bool AttachPipeline::DispatchUntil(std::chrono::steady_clock::time_point limit)
+{
+	std::vector<Scheduler::Key> due;
+
+	while (true)
+	{
+		due.clear();
+		const bool woken = scheduler.WaitUntilDue(due, limit);
+
+		// every Post is followed by a Wake, so anything posted before the wake is in the queue by now
+		RunCommands();
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			for (auto id : due)
+			{
+				auto it = entries.find(id);
+				if (it != entries.end() && !it->second->busy && !it->second->process.IsDone())
+					Submit(it->second); // a busy process is rescheduled when it's done
+			}
+		}
+
+		if (woken)
+			return true;
+
+		if (std::chrono::steady_clock::now() >= limit)
+			return false;
+	}
+}
+
+void AttachPipeline::Wake()
+{
+	scheduler.Wake();
+}
+
+void AttachPipeline::Post(std::function<void()> command)
+{
+	commands.Push(std::move(command));
+	scheduler.Wake();
+}
+
+void AttachPipeline::PostForEach(Action action)
+{
+	Post([this, action = std::move(action)]()
+	{
+		ForEach(action);
+	});
+}
+
+void AttachPipeline::RunCommands()
+{
+	std::function<void()> command;
+	while (commands.Pop(command))
+		command();
+}
+
+void AttachPipeline::Run(const std::shared_ptr<Entry> &entry, const Action &first)
+{
+	Trace::Span span("Run", "attach", Trace::Value("pid", entry->id));
+	first(entry->process);
+
+	while (true)
+	{
+		std::vector<Action> actions;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			actions.swap(entry->deferred);
+
+			if (actions.empty())
+			{
+				entry->busy = false;
+				Reschedule(entry);
+				if (--busy_count == 0)
+					idle.notify_all();
+				return;
+			}
+		}
+
+		for (const auto &action : actions)
+			action(entry->process);
+	}
+}
+
+void AttachPipeline::ForEach(const Action &action)
+{
+	std::vector<std::shared_ptr<Entry>> ready;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		for (auto &it : entries)
+		{
+			auto &entry = it.second;
+			if (entry->busy)
+			{
+				entry->deferred.push_back(action);
+			}
+			else
+			{
+				entry->busy = true;
+				busy_count++;
+				ready.push_back(entry);
+			}
+		}
+	}
+
+	for (const auto &entry : ready)
+		Run(entry, action);
+}
+
+void AttachPipeline::CancelAll()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	for (auto &it : entries)
+		it.second->process.Cancel();
+}
+
+void AttachPipeline::WaitIdle()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	idle.wait(guard, [&] { return busy_count == 0; });
+}
\ No newline at end of file
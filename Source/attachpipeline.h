@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "mpscqueue.h"
+#include "robloxprocess.h"
+#include "scheduler.h"
+#include "threadpool.h"
+
+// Runs every process' attach state machine (see AttachState) on a small pool, so a process that's slow to map its module
+// or to scan never holds up the others. At most one step or action runs per process at a time; actions that arrive while a
+// step is running are queued and run right after it.
+// The thread calling DispatchUntil owns the processes: other threads (UI, signals) reach them by posting commands to it.
+class AttachPipeline
+{
+public:
+	using Id = uint64_t; // process id
+	using StartTime = uint64_t; // with the id, tells a reused pid apart from the process it used to be; 0 if unknown
+	using Action = std::function<void(RobloxProcess &)>;
+
+	explicit AttachPipeline(size_t thread_count = DefaultThreadCount());
+	~AttachPipeline();
+
+	AttachPipeline(const AttachPipeline &) = delete;
+	AttachPipeline &operator=(const AttachPipeline &) = delete;
+
+	// True if `id` is in the pipeline as the process started at `start_time` (a start time of 0 matches any)
+	bool Contains(Id id, StartTime start_time);
+	size_t GetCount();
+
+	// The first step is submitted right away. An entry left behind by an earlier process with the same id is removed first.
+	void Add(Id id, StartTime start_time, std::unique_ptr<ProcUtil::MemorySource> source, RobloxHandleType type, int retry_count);
+
+	// Cancels the process' current step, if any; the process is destroyed once that step returns.
+	// `is_dead` only gets to look at the process (GetMemory), it runs while the pipeline is locked.
+	void Remove(Id id);
+	void RemoveIf(const std::function<bool(Id id, StartTime start_time, RobloxProcess &process)> &is_dead);
+
+	// Sleeps until each process' next step is due and submits it, until `limit` or Wake(). Returns true if woken.
+	bool DispatchUntil(std::chrono::steady_clock::time_point limit);
+
+	// From any thread: DispatchUntil returns early (so the caller can look for new or exited processes right away)
+	void Wake();
+
+	// From any thread, without locking: `command` runs on the thread in DispatchUntil, which is woken for it
+	void Post(std::function<void()> command);
+
+	// Runs `action` on every process: right away on the calling thread if it's idle, else after its current step
+	void ForEach(const Action &action);
+
+	// Post(ForEach(action))
+	void PostForEach(Action action);
+
+	// Cancels every step in progress so it returns as soon as possible (used before restoring every process on exit)
+	void CancelAll();
+
+	// Blocks until no step or action is running
+	void WaitIdle();
+
+	static size_t DefaultThreadCount(); // a few threads are plenty: attaching is mostly waiting on the target process
+
+private:
+	struct Entry
+	{
+		Id id = 0;
+		StartTime start_time = 0;
+		RobloxProcess process;
+		bool busy = false; // a step or action is running (guarded by AttachPipeline::lock)
+		std::vector<Action> deferred; // guarded by AttachPipeline::lock
+	};
+
+	// Runs `first` and then anything deferred meanwhile; the entry must have been marked busy
+	void Run(const std::shared_ptr<Entry> &entry, const Action &first);
+	void Submit(const std::shared_ptr<Entry> &entry);
+	void Reschedule(const std::shared_ptr<Entry> &entry);
+	using EntryMap = std::unordered_map<Id, std::shared_ptr<Entry>>;
+	EntryMap::iterator Erase(EntryMap::iterator it);
+	void StepWaiting();
+	void RunCommands();
+
+	std::mutex lock;
+	std::condition_variable idle;
+	EntryMap entries;
+	size_t busy_count = 0;
+	Scheduler scheduler; // next step of every idle process
+	MpscQueue<std::function<void()>> commands;
+
+	ThreadPool pool; // last, so it's joined before anything its tasks use is destroyed
+};
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "rfu.h"
+#include "procutil.h"
+#include "threadpool.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Scans a synthetic 80 MB "client image" in our own process with 1..N threads (run with --benchmark)
+
+void RunScanBenchmark()
+{
+	const size_t image_size = 80 * 1024 * 1024;
+	const char *aob = "\x40\x53\x48\x83\xEC\x20\x0F\xB6\xD9\xE8\x00\x00\x00\x00\x86\x58\x04\x48\x83\xC4\x20\x5B\xC3";
+	const char *mask = "xxxxxxxxxx????xxxxxxxxx";
+
+	printf("Building %zu MB synthetic image...\n", image_size / (1024 * 1024));
+
+	std::vector<uint8_t> image(image_size);
+	std::mt19937 rng(1337);
+	for (size_t i = 0; i + sizeof(uint32_t) <= image.size(); i += sizeof(uint32_t))
+	{
+		const uint32_t value = rng();
+		memcpy(image.data() + i, &value, sizeof(value));
+	}
+
+	// near the end so every chunk before it has to be read and scanned
+	uint8_t *expected = image.data() + image_size - image_size / 16;
+	memcpy(expected, aob, strlen(mask));
+
+	const HANDLE self = GetCurrentProcess();
+	const uint8_t *start = image.data();
+	const uint8_t *end = image.data() + image.size();
+	const int runs = 5;
+
+	auto measure = [&](auto &&scan) -> double
+	{
+		double best = 0.0;
+
+		for (int run = 0; run < runs; run++)
+		{
+			const auto start_time = std::chrono::steady_clock::now();
+			const void *result = scan();
+			const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+			if (result != expected)
+				printf("[Benchmark] Unexpected result %p (expected %p)\n", result, expected);
+
+			if (run == 0 || elapsed < best) best = elapsed;
+		}
+
+		return best;
+	};
+
+	ProcUtil::PipelinedReads = false;
+	const double unpipelined = measure([&] { return ProcUtil::ScanProcess(self, aob, mask, start, end); });
+	printf("[Benchmark] ScanProcess (single buffer): %.2f ms (%.0f MB/s)\n", unpipelined, image_size / (1024.0 * 1024.0) / (unpipelined / 1000.0));
+
+	ProcUtil::PipelinedReads = true;
+	const double serial = measure([&] { return ProcUtil::ScanProcess(self, aob, mask, start, end); });
+	printf("[Benchmark] ScanProcess (pipelined reads): %.2f ms (%.0f MB/s, %.2fx)\n", serial, image_size / (1024.0 * 1024.0) / (serial / 1000.0), unpipelined / serial);
+
+	const size_t max_threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	for (size_t threads = 1; threads <= max_threads; threads++)
+	{
+		ThreadPool pool(threads - 1);
+		const double elapsed = measure([&] { return ProcUtil::ScanProcessParallel(self, aob, mask, pool, start, end); });
+		printf("[Benchmark] ScanProcessParallel (%2zu threads): %.2f ms (%.0f MB/s, %.2fx)\n", threads, elapsed, image_size / (1024.0 * 1024.0) / (elapsed / 1000.0), serial / elapsed);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "exitwatcher.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434 // Linux 5.3, missing from older headers
+#endif
+#endif
+
+#ifdef _WIN32
+
+struct ExitWatcher::Watched
+{
+	ExitWatcher *owner;
+	Id id;
+	HANDLE process = NULL;
+	HANDLE wait = NULL;
+
+	static void CALLBACK OnSignaled(PVOID context, BOOLEAN)
+	{
+		auto watched = (Watched *)context;
+		watched->owner->OnExit(watched->id);
+	}
+};
+
+ExitWatcher::ExitWatcher(std::function<void()> on_exit)
+	: on_exit(std::move(on_exit))
+{
+}
+
+bool ExitWatcher::Watch(Id id)
+{
+	// a handle of our own: the attach side's handle doesn't have SYNCHRONIZE and may be replaced (UpgradeHandle)
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)id);
+	if (!process)
+		return false;
+
+	auto entry = std::make_unique<Watched>();
+	entry->owner = this;
+	entry->id = id;
+	entry->process = process;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (watched.count(id))
+	{
+		CloseHandle(process);
+		return true;
+	}
+
+	if (!RegisterWaitForSingleObject(&entry->wait, process, Watched::OnSignaled, entry.get(), INFINITE, WT_EXECUTEONLYONCE))
+	{
+		CloseHandle(process);
+		return false;
+	}
+
+	watched[id] = std::move(entry);
+	return true;
+}
+
+// Called without `lock`: UnregisterWaitEx waits for a callback in progress, which takes `lock`
+void ExitWatcher::Close(std::unique_ptr<Watched> entry)
+{
+	UnregisterWaitEx(entry->wait, INVALID_HANDLE_VALUE);
+	CloseHandle(entry->process);
+}
+
+#else
+
+struct ExitWatcher::Watched
+{
+	int pidfd = -1;
+};
+
+ExitWatcher::ExitWatcher(std::function<void()> on_exit)
+	: on_exit(std::move(on_exit))
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	stop_fd = eventfd(0, EFD_CLOEXEC);
+
+	if (epoll_fd < 0 || stop_fd < 0)
+		return; // Watch fails, everything gets polled
+
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = UINT64_MAX;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
+
+	thread = std::thread(&ExitWatcher::Run, this);
+}
+
+bool ExitWatcher::Watch(Id id)
+{
+	if (!thread.joinable())
+		return false;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (watched.count(id))
+		return true;
+
+	// a pidfd becomes readable once the process has exited, and unlike the pid it can't be reused meanwhile
+	const int pidfd = (int)syscall(SYS_pidfd_open, (pid_t)id, 0);
+	if (pidfd < 0)
+		return false;
+
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = id;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pidfd, &event) != 0)
+	{
+		close(pidfd);
+		return false;
+	}
+
+	auto entry = std::make_unique<Watched>();
+	entry->pidfd = pidfd;
+	watched[id] = std::move(entry);
+	return true;
+}
+
+void ExitWatcher::Close(std::unique_ptr<Watched> entry)
+{
+	close(entry->pidfd); // also takes it out of the epoll set
+}
+
+void ExitWatcher::Run()
+{
+	epoll_event events[16];
+
+	while (true)
+	{
+		const int count = epoll_wait(epoll_fd, events, 16, -1);
+
+		for (int i = 0; i < count; i++)
+		{
+			if (events[i].data.u64 == UINT64_MAX)
+				return;
+
+			OnExit(events[i].data.u64);
+		}
+	}
+}
+
+#endif
+
+ExitWatcher::~ExitWatcher()
+{
+#ifndef _WIN32
+	if (thread.joinable())
+	{
+		const uint64_t value = 1;
+		if (write(stop_fd, &value, sizeof(value)) == sizeof(value))
+			thread.join();
+		else
+			thread.detach();
+	}
+#endif
+
+	std::unordered_map<Id, std::unique_ptr<Watched>> remaining;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		remaining.swap(watched);
+	}
+
+	for (auto &it : remaining)
+		Close(std::move(it.second));
+
+#ifndef _WIN32
+	if (epoll_fd >= 0) close(epoll_fd);
+	if (stop_fd >= 0) close(stop_fd);
+#endif
+}
+
+void ExitWatcher::OnExit(Id id)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+#ifndef _WIN32
+		// the pidfd stays readable, so it leaves the epoll set now rather than in TakeExited
+		auto it = watched.find(id);
+		if (it == watched.end())
+			return; // unwatched meanwhile
+
+		Close(std::move(it->second));
+		watched.erase(it);
+#endif
+
+		exited.push_back(id);
+	}
+
+	on_exit();
+}
+
+void ExitWatcher::Unwatch(Id id)
+{
+	std::unique_ptr<Watched> entry;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		auto it = watched.find(id);
+		if (it == watched.end())
+			return;
+
+		entry = std::move(it->second);
+		watched.erase(it);
+	}
+
+	Close(std::move(entry));
+}
+
+bool ExitWatcher::IsWatching(Id id)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return watched.count(id) != 0;
+}
+
+std::vector<ExitWatcher::Id> ExitWatcher::TakeExited()
+{
+	std::vector<Id> result;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		result.swap(exited);
+	}
+
+#ifdef _WIN32
+	for (auto id : result)
+		Unwatch(id);
+#endif
+
+	return result;
+}
\ No newline at end of file
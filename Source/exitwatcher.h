@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Notices processes exiting as it happens instead of polling each of them: a registered wait per process on Windows,
+// a pidfd per process in one epoll set on Linux.
+class ExitWatcher
+{
+public:
+	using Id = uint64_t; // process id
+
+	// `on_exit` runs on a watcher thread right after a watched process exits (e.g. to wake whoever calls TakeExited)
+	explicit ExitWatcher(std::function<void()> on_exit);
+	~ExitWatcher();
+
+	ExitWatcher(const ExitWatcher &) = delete;
+	ExitWatcher &operator=(const ExitWatcher &) = delete;
+
+	// Returns false if the process can't be watched (gone already, access denied, no pidfd support...); poll it instead
+	bool Watch(Id id);
+	void Unwatch(Id id);
+	bool IsWatching(Id id);
+
+	// Processes that exited since the last call, which are no longer watched
+	std::vector<Id> TakeExited();
+
+private:
+	struct Watched;
+
+	void OnExit(Id id);
+	void Close(std::unique_ptr<Watched> watched);
+
+	std::function<void()> on_exit;
+
+	std::mutex lock;
+	std::unordered_map<Id, std::unique_ptr<Watched>> watched;
+	std::vector<Id> exited;
+
+#ifndef _WIN32
+	void Run();
+
+	int epoll_fd = -1;
+	int stop_fd = -1; // eventfd that ends Run
+	std::thread thread;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#include "sigscan.h"
+
+// Read-only view of a module's code, addressed as if it were loaded at the live process's base.
+// Implemented by the live snapshot (ProcUtil::ModuleSnapshot) and by the executable mapped from disk (MappedImage),
+// so the signatures run unchanged on either and always produce live addresses.
+class ImageView
+{
+public:
+	using MatchCallback = std::function<bool(const uint8_t *address, const uint8_t *local)>;
+
+	virtual ~ImageView() = default;
+
+	virtual std::pair<const uint8_t *, const uint8_t *> GetCodeRange() const = 0; // [start, end) spanning the code sections
+	virtual const uint8_t *Get(const void *address, size_t size) = 0; // local copy of [address, address + size), nullptr if unavailable
+
+	virtual bool ScanAll(const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start, const uint8_t *end) = 0;
+	virtual bool Scan(const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start, const uint8_t *end) = 0;
+
+	// Added to absolute addresses found in the view's code to get live ones (0 unless the view holds unrelocated code)
+	virtual intptr_t GetRelocationDelta() const = 0;
+
+	void *Scan(const char *aob, const char *mask, const uint8_t *start, const uint8_t *end)
+	{
+		void *result = nullptr;
+
+		ScanAll(aob, mask, [&](const uint8_t *address, const uint8_t *)
+		{
+			result = (void *)address;
+			return false;
+		}, start, end);
+
+		return result;
+	}
+
+	bool Read(const void *address, void *buffer, size_t size)
+	{
+		if (const uint8_t *local = Get(address, size))
+		{
+			memcpy(buffer, local, size);
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename T>
+	bool Read(const void *address, T &out)
+	{
+		return Read(address, &out, sizeof(T));
+	}
+};
\ No newline at end of file
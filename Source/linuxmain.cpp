@@ -0,0 +1,278 @@
+// Linux front-end for Roblox running under Wine. Attaches to every Wine RobloxPlayerBeta.exe (and RobloxStudioBeta.exe with --studio)
+// and keeps them unlocked until interrupted, at which point memory-unlocked clients are set back to 60 FPS.
+//
+// Usage: rbxfpsunlocker [--fps <cap>] [--method hybrid|memory|flags] [--studio] [--once] [--trace <file>] [--log <levels>] [--metrics <socket>]
+// Send SIGUSR1 to print how long each attach phase took so far. --trace records a timeline of scans and attach steps
+// as Chrome trace-event JSON. --log takes a level for everything ("debug") or per subsystem ("procutil=debug,scan=warning").
+// --metrics serves Prometheus metrics on a Unix socket (see metrics.h).
+//
+// Built by the CMakeLists.txt at the repository root: cmake -S . -B build && cmake --build build && ctest --test-dir build
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+
+#include "rfu.h"
+#include "settings.h"
+#include "robloxprocess.h"
+#include "attachpipeline.h"
+#include "exitwatcher.h"
+#include "phasestats.h"
+#include "log.h"
+#include "metrics.h"
+#include "trace.h"
+#include "wine.h"
+
+AttachPipeline &GetPipeline()
+{
+	// created on first use, after main blocked SIGINT/SIGTERM, so its workers inherit the mask and only the signal thread sees them.
+	// Never destroyed, since the signal thread may still be posting to it while the process exits.
+	static auto *pipeline = new AttachPipeline();
+	return *pipeline;
+}
+
+void NotifyError(const char *, const char *error)
+{
+	if (!Settings::SilentErrors)
+		RFU_LOG(Error, General, "[ERROR] %s\n", error); // errors go to stderr
+}
+
+void NotifyInfo(const char *title, const char *message)
+{
+	printf("[%s] %s\n", title, message);
+}
+
+// Posted to the main thread, which owns every process
+
+void RFU_SetFPSCap(double value)
+{
+	GetPipeline().PostForEach([value](RobloxProcess &process)
+	{
+		process.SetFPSCap(value);
+	});
+}
+
+void RFU_OnUIUnlockMethodChange()
+{
+	GetPipeline().PostForEach([](RobloxProcess &process)
+	{
+		process.OnUnlockMethodUpdate();
+	});
+}
+
+// Main thread only, once it stopped dispatching
+void RFU_OnUIClose()
+{
+	auto &pipeline = GetPipeline();
+
+	pipeline.CancelAll();
+	pipeline.ForEach([](RobloxProcess &process)
+	{
+		process.OnUIClose();
+	});
+	pipeline.WaitIdle();
+}
+
+// Alive and still the process started at `start_time`, not another one the pid was reused for
+bool IsProcessAlive(pid_t pid, uint64_t start_time)
+{
+	if (kill(pid, 0) != 0 && errno == ESRCH)
+		return false;
+
+	const uint64_t current = start_time ? Wine::GetStartTime(pid) : 0;
+	return current == 0 || current == start_time;
+}
+
+bool ParseArguments(int argc, char **argv, bool &once, const char *&trace_path, const char *&metrics_path)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+		{
+			Settings::FPSCap = strtod(argv[++i], nullptr);
+			Settings::Update(); // posted after the value Settings::Init posted, so it's the one processes end up with
+		}
+		else if (strcmp(argv[i], "--method") == 0 && i + 1 < argc)
+		{
+			const char *method = argv[++i];
+			if (strcmp(method, "hybrid") == 0) Settings::UnlockMethod = Settings::UnlockMethodType::Hybrid;
+			else if (strcmp(method, "memory") == 0) Settings::UnlockMethod = Settings::UnlockMethodType::MemoryWrite;
+			else if (strcmp(method, "flags") == 0) Settings::UnlockMethod = Settings::UnlockMethodType::FlagsFile;
+			else return false;
+		}
+		else if (strcmp(argv[i], "--studio") == 0)
+		{
+			Settings::UnlockStudio = true;
+		}
+		else if (strcmp(argv[i], "--once") == 0)
+		{
+			once = true;
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			trace_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+		{
+			metrics_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc)
+		{
+			if (!Log::Configure(argv[++i])) return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	// SIGINT/SIGTERM (and SIGUSR1) are handled by a thread of their own, which can safely wake the main loop.
+	// Blocked before anything else so every thread started later (the attach pool included) inherits the mask
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+	Trace::SetThreadName("main");
+	Settings::Init();
+
+	bool once = false;
+	const char *trace_path = nullptr;
+	const char *metrics_path = nullptr;
+	if (!ParseArguments(argc, argv, once, trace_path, metrics_path))
+	{
+		fprintf(stderr, "Usage: %s [--fps <cap>] [--method hybrid|memory|flags] [--studio] [--once] [--trace <file>] [--log <levels>] [--metrics <socket>]\n", argv[0]);
+		return 1;
+	}
+
+	if (metrics_path && !Metrics::Start(metrics_path))
+	{
+		fprintf(stderr, "Unable to serve metrics on %s\n", metrics_path);
+		return 1;
+	}
+
+	if (trace_path && !Trace::Start(trace_path))
+	{
+		fprintf(stderr, "Unable to write trace to %s\n", trace_path);
+		return 1;
+	}
+
+	Log::Start();
+	auto &pipeline = GetPipeline();
+
+	bool interrupted = false; // set by a command posted from the signal thread
+
+	std::thread([signals, &pipeline, &interrupted]()
+	{
+		int signal = 0;
+
+		// SIGUSR1 prints the attach timings so far
+		while (sigwait(&signals, &signal) == 0 && signal == SIGUSR1)
+			PhaseStats::Dump(stdout);
+
+		pipeline.Post([&interrupted]()
+		{
+			interrupted = true;
+		});
+	}).detach();
+
+	ExitWatcher exit_watcher([&pipeline]() { pipeline.Wake(); });
+
+	printf("Roblox FPS Unlocker %s (Wine), cap %.0f\n", RFU_VERSION, Settings::FPSCap);
+	printf("Waiting for Roblox...\n");
+
+	while (!interrupted)
+	{
+		struct Target
+		{
+			const char *image_name;
+			RobloxHandleType type;
+		};
+
+		std::vector<Target> targets;
+		if (Settings::UnlockClient) targets.push_back({ "RobloxPlayerBeta.exe", RobloxHandleType::Client });
+		if (Settings::UnlockStudio) targets.push_back({ "RobloxStudioBeta.exe", RobloxHandleType::Studio });
+
+		std::vector<const char *> image_names;
+		for (const auto &target : targets)
+			image_names.push_back(target.image_name);
+
+		Trace::Span tick_span("Tick", "watch");
+
+		PhaseStats::Timer enumerate_timer(PhaseStats::Phase::Enumerate);
+		const auto matches = Wine::FindProcessesByImageNames(image_names);
+		enumerate_timer.Stop();
+
+		for (const auto &match : matches)
+		{
+			const pid_t pid = match.id;
+			const Target &target = targets[match.image];
+
+			if (pipeline.Contains(pid, match.start_time))
+				continue;
+
+			RFU_LOG(Info, Watch, "Injecting into new process %s (pid %d)\n", target.image_name, pid);
+
+			if (once)
+			{
+				RobloxProcess roblox_process;
+				const bool attached = roblox_process.Attach(std::make_unique<Wine::WineMemorySource>(pid, target.image_name), target.type, 0);
+				Metrics::Stop();
+				Log::Stop();
+				printf(attached ? "\nSuccess!\n" : "\nERROR: unable to attach to process\n");
+				tick_span.Stop();
+				Trace::Stop();
+				return attached ? 0 : 1;
+			}
+
+			pipeline.Add(pid, match.start_time, std::make_unique<Wine::WineMemorySource>(pid, target.image_name), target.type, 5);
+
+			exit_watcher.Unwatch(pid); // may still be watching the process that had this pid before
+			if (!exit_watcher.Watch(pid))
+				RFU_LOG(Warning, Watch, "Unable to watch pid %d for exit, polling it instead\n", pid);
+		}
+
+		// processes that exited are no longer watched once taken, so anything still watched is alive and only the rest need checking
+		exit_watcher.TakeExited();
+
+		pipeline.RemoveIf([&exit_watcher](AttachPipeline::Id id, AttachPipeline::StartTime start_time, RobloxProcess &)
+		{
+			if (exit_watcher.IsWatching(id) || IsProcessAlive((pid_t)id, start_time))
+				return false;
+
+			RFU_LOG(Info, Watch, "Purging dead process (pid %d)\n", (int)id);
+			return true;
+		});
+
+		Metrics::SetAttachedProcesses(pipeline.GetCount());
+		tick_span.Stop();
+
+		// new processes are looked for every second; in between, the thread only wakes when a process' next step is due or one exits
+		pipeline.DispatchUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(1000));
+	}
+
+	RFU_LOG(Info, Watch, "Restoring 60 FPS and exiting\n");
+	RFU_OnUIClose();
+	Metrics::Stop();
+	Log::Stop();
+	Trace::Stop();
+	return 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "linuxmemory.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <sys/uio.h>
+
+ProcUtil::LinuxMemorySource::LinuxMemorySource(pid_t pid)
+	: pid(pid)
+{
+}
+
+bool ProcUtil::LinuxMemorySource::Is64Bit()
+{
+	if (!is_64bit.has_value())
+	{
+		// EI_CLASS of the executable: 1 = ELFCLASS32, 2 = ELFCLASS64
+		std::ifstream file("/proc/" + std::to_string(pid) + "/exe", std::ios::binary);
+		char ident[5]{};
+		file.read(ident, sizeof(ident));
+		is_64bit = !file || ident[4] != 1;
+	}
+
+	return *is_64bit;
+}
+
+bool ProcUtil::LinuxMemorySource::Read(const void *address, void *buffer, size_t size, size_t *bytes_read)
+{
+	struct iovec local = { buffer, size };
+	struct iovec remote = { (void *)address, size };
+
+	const ssize_t copied = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+	CountRead(copied > 0 ? (size_t)copied : 0);
+
+	if (bytes_read) *bytes_read = copied > 0 ? (size_t)copied : 0;
+	return copied >= 0 && (size_t)copied == size;
+}
+
+bool ProcUtil::LinuxMemorySource::Write(const void *address, const void *buffer, size_t size)
+{
+	struct iovec local = { (void *)buffer, size };
+	struct iovec remote = { (void *)address, size };
+
+	return process_vm_writev(pid, &local, 1, &remote, 1, 0) == (ssize_t)size;
+}
+
+// One process_vm_readv per IOV_MAX requests. The kernel stops at the first remote iovec it can't read,
+// so after a failure the batch resumes with the request after the failed one.
+size_t ProcUtil::LinuxMemorySource::ReadMany(ReadRequest *requests, size_t count)
+{
+	std::vector<struct iovec> local, remote;
+	size_t completed = 0;
+	size_t i = 0;
+
+	while (i < count)
+	{
+		const size_t batch = (std::min)(count - i, (size_t)IOV_MAX);
+		local.resize(batch);
+		remote.resize(batch);
+
+		for (size_t j = 0; j < batch; j++)
+		{
+			local[j] = { requests[i + j].buffer, requests[i + j].size };
+			remote[j] = { (void *)requests[i + j].address, requests[i + j].size };
+			requests[i + j].bytes_read = 0;
+		}
+
+		ssize_t copied = process_vm_readv(pid, local.data(), batch, remote.data(), batch, 0);
+		CountRead(copied > 0 ? (size_t)copied : 0);
+
+		if (copied < 0)
+		{
+			i++; // the first request is unreadable
+			continue;
+		}
+
+		size_t j = 0;
+		while (j < batch && (size_t)copied >= requests[i + j].size)
+		{
+			requests[i + j].bytes_read = requests[i + j].size;
+			copied -= requests[i + j].size;
+			completed++;
+			j++;
+		}
+
+		if (j < batch)
+		{
+			requests[i + j].bytes_read = (size_t)copied; // partial, counts as failed
+			j++;
+		}
+
+		i += j;
+	}
+
+	return completed;
+}
+
+bool ProcUtil::LinuxMemorySource::LoadMappings()
+{
+	std::ifstream file("/proc/" + std::to_string(pid) + "/maps");
+	if (!file.is_open())
+		return false;
+
+	mappings.clear();
+
+	// 7f1c2a400000-7f1c2a428000 r--p 00000000 08:01 1234 /usr/lib/libc.so.6
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string range, perms, offset, device, inode, path;
+		stream >> range >> perms >> offset >> device >> inode;
+		std::getline(stream >> std::ws, path);
+
+		const size_t dash = range.find('-');
+		if (dash == std::string::npos || perms.empty())
+			continue;
+
+		Mapping mapping;
+		mapping.start = (const uint8_t *)std::stoull(range.substr(0, dash), nullptr, 16);
+		mapping.end = (const uint8_t *)std::stoull(range.substr(dash + 1), nullptr, 16);
+		mapping.readable = perms[0] == 'r';
+		mapping.path = std::move(path);
+		mappings.push_back(std::move(mapping));
+	}
+
+	return true;
+}
+
+bool ProcUtil::LinuxMemorySource::QueryRegion(const void *address, MemoryRegion &out)
+{
+	const auto target = (const uint8_t *)address;
+
+	// region walks move forward, so the maps are parsed once per walk instead of once per query (and again after FlushLayoutCache)
+	if (mappings.empty() || target <= last_query)
+	{
+		if (!LoadMappings())
+			return false;
+	}
+
+	last_query = target;
+
+	auto it = std::upper_bound(mappings.begin(), mappings.end(), target, [](const uint8_t *value, const Mapping &mapping)
+	{
+		return value < mapping.end;
+	});
+
+	if (it == mappings.end())
+		return false;
+
+	if (target >= it->start)
+	{
+		out.base = it->start;
+		out.size = it->end - it->start;
+		out.readable = it->readable;
+	}
+	else
+	{
+		// gap before the next mapping
+		out.base = it == mappings.begin() ? nullptr : std::prev(it)->end;
+		out.size = it->start - out.base;
+		out.readable = false;
+	}
+
+	return true;
+}
+
+std::vector<ProcUtil::ModuleInfo> ProcUtil::LinuxMemorySource::GetModules()
+{
+	std::vector<ModuleInfo> result;
+	if (!LoadMappings())
+		return result;
+
+	// a module spans every consecutive mapping of the same file
+	for (const auto &mapping : mappings)
+	{
+		if (mapping.path.empty() || mapping.path[0] != '/')
+			continue;
+
+		if (!result.empty() && result.back().path == mapping.path)
+		{
+			result.back().size = mapping.end - (const uint8_t *)result.back().base;
+			continue;
+		}
+
+		ModuleInfo info{};
+		info.path = mapping.path;
+		info.base = (void *)mapping.start;
+		info.size = mapping.end - mapping.start;
+		result.push_back(std::move(info));
+	}
+
+	return result;
+}
+
+bool ProcUtil::LinuxMemorySource::GetMainModule(ModuleInfo &out)
+{
+	std::error_code ec{};
+	const auto executable = std::filesystem::read_symlink("/proc/" + std::to_string(pid) + "/exe", ec);
+	if (ec)
+		return false;
+
+	for (auto &module : GetModules())
+	{
+		if (module.path == executable)
+		{
+			out = std::move(module);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <optional>
+#include <string>
+#include <sys/types.h>
+
+#include "memorysource.h"
+
+namespace ProcUtil
+{
+	// MemorySource over any Linux process using process_vm_readv/process_vm_writev and /proc/<pid>/maps.
+	// Needs the same access as ptrace (same user with ptrace_scope 0, or CAP_SYS_PTRACE).
+	class LinuxMemorySource : public MemorySource
+	{
+	public:
+		explicit LinuxMemorySource(pid_t pid);
+
+		pid_t GetProcessId() const { return pid; }
+
+		const void *GetTag() const override { return (const void *)(uintptr_t)pid; }
+		bool Is64Bit() override;
+
+		bool Read(const void *address, void *buffer, size_t size, size_t *bytes_read = nullptr) override;
+		bool Write(const void *address, const void *buffer, size_t size) override;
+		size_t ReadMany(ReadRequest *requests, size_t count) override;
+		bool QueryRegion(const void *address, MemoryRegion &out) override;
+		void FlushLayoutCache() override { mappings.clear(); }
+
+		std::vector<ModuleInfo> GetModules() override;
+		bool GetMainModule(ModuleInfo &out) override;
+
+	private:
+		struct Mapping
+		{
+			const uint8_t *start;
+			const uint8_t *end;
+			bool readable;
+			std::string path;
+		};
+
+		bool LoadMappings();
+
+		pid_t pid;
+		std::optional<bool> is_64bit;
+
+		std::vector<Mapping> mappings;
+		const uint8_t *last_query = nullptr;
+	};
+}
+
+#endif
\ No newline at end of file
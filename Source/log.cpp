@@ -0,0 +1,497 @@
+#include "log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+std::atomic<Log::Level> Log::Levels[(size_t)Log::Subsystem::Count] = {
+	Level::Info, Level::Info, Level::Info, Level::Info, Level::Info
+};
+
+namespace
+{
+	using Log::Detail::ArgType;
+	using Log::Detail::Record;
+
+	const size_t RecordHeaderSize = offsetof(Record, data);
+
+	// Single producer (its thread), single consumer (whoever holds `lock`)
+	struct ThreadBuffer
+	{
+		static const size_t Capacity = 256;
+
+		Record records[Capacity];
+		std::atomic<size_t> head{ 0 }; // next record to write
+		std::atomic<size_t> tail{ 0 }; // next record to print
+		std::atomic<bool> retired{ false }; // the thread exited; freed once drained
+
+		bool Push(const Record &record)
+		{
+			const size_t position = head.load(std::memory_order_relaxed);
+			if (position - tail.load(std::memory_order_acquire) >= Capacity)
+				return false;
+
+			memcpy(&records[position % Capacity], &record, RecordHeaderSize + record.length);
+			head.store(position + 1, std::memory_order_release);
+			return true;
+		}
+	};
+
+	std::mutex lock; // guards everything below and the output streams; never taken to log while the writer runs
+	std::vector<ThreadBuffer *> buffers;
+	std::thread writer;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	std::atomic<bool> running{ false };
+	std::atomic<uint64_t> next_sequence{ 0 };
+
+	struct ThreadState
+	{
+		ThreadBuffer *buffer = nullptr; // created on the thread's first message
+
+		~ThreadState()
+		{
+			if (buffer) buffer->retired.store(true, std::memory_order_release);
+		}
+	};
+
+	thread_local ThreadState CurrentThread;
+
+	ThreadBuffer *GetThreadBuffer()
+	{
+		if (!CurrentThread.buffer)
+		{
+			auto buffer = new ThreadBuffer();
+
+			std::lock_guard<std::mutex> guard(lock);
+			buffers.push_back(buffer);
+			CurrentThread.buffer = buffer;
+		}
+
+		return CurrentThread.buffer;
+	}
+
+	struct Arg
+	{
+		ArgType type;
+		uint64_t bits; // Signed, Unsigned, Double, Pointer
+		const uint8_t *characters; // String, WideString
+		size_t count;
+
+		double AsDouble() const
+		{
+			if (type == ArgType::Signed) return (double)(int64_t)bits;
+			if (type != ArgType::Double) return (double)bits;
+
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		uint64_t AsInteger() const
+		{
+			return type == ArgType::Double ? (uint64_t)(int64_t)AsDouble() : bits;
+		}
+	};
+
+	bool ReadArg(const Record &record, size_t &offset, Arg &arg)
+	{
+		if (offset >= record.length)
+			return false;
+
+		arg.type = (ArgType)record.data[offset++];
+
+		if (arg.type == ArgType::String || arg.type == ArgType::WideString)
+		{
+			uint16_t units;
+			memcpy(&units, record.data + offset, sizeof(units));
+			arg.characters = record.data + offset + sizeof(units);
+			arg.count = units;
+			offset += sizeof(units) + units * (arg.type == ArgType::String ? sizeof(char) : sizeof(wchar_t));
+		}
+		else
+		{
+			memcpy(&arg.bits, record.data + offset, sizeof(uint64_t));
+			offset += sizeof(uint64_t);
+		}
+
+		return true;
+	}
+
+	template <typename T>
+	void AppendFormatted(std::string &out, const char *spec, T value)
+	{
+		char buffer[128];
+		const int count = snprintf(buffer, sizeof(buffer), spec, value);
+		if (count < 0)
+			return;
+
+		if ((size_t)count < sizeof(buffer))
+		{
+			out.append(buffer, count);
+			return;
+		}
+
+		const size_t offset = out.size();
+		out.resize(offset + count + 1);
+		snprintf(&out[offset], count + 1, spec, value);
+		out.resize(offset + count);
+	}
+
+	// printf, with the arguments coming from the record instead of the stack
+	void Format(const Record &record, std::string &out)
+	{
+		size_t offset = 0;
+
+		for (const char *i = record.format; *i;)
+		{
+			if (*i != '%')
+			{
+				const char *next = strchr(i, '%');
+				if (!next) next = i + strlen(i);
+				out.append(i, next);
+				i = next;
+				continue;
+			}
+
+			if (i[1] == '%')
+			{
+				out += '%';
+				i += 2;
+				continue;
+			}
+
+			// %[flags][width][.precision][length]conversion; the length is replaced to match how the argument was stored
+			const char *start = i++;
+			while (*i && strchr("-+ #0", *i)) i++;
+			while (isdigit((unsigned char)*i)) i++;
+			if (*i == '.')
+			{
+				i++;
+				while (isdigit((unsigned char)*i)) i++;
+			}
+
+			std::string spec(start, i);
+			const bool long_length = *i == 'l';
+			while (*i && strchr("hlLqjztI0123456789", *i)) i++; // I64 and friends included
+			const char conversion = *i;
+			if (!conversion)
+				break;
+			i++;
+
+			Arg arg{};
+			if (!ReadArg(record, offset, arg))
+			{
+				out += "(?)";
+				continue;
+			}
+
+			const bool is_string = arg.type == ArgType::String || arg.type == ArgType::WideString;
+			const uint64_t number = is_string ? 0 : arg.AsInteger();
+
+			switch (conversion)
+			{
+			case 'd': case 'i':
+				AppendFormatted(out, (spec + "ll" + conversion).c_str(), (long long)number);
+				break;
+			case 'u': case 'o': case 'x': case 'X':
+				AppendFormatted(out, (spec + "ll" + conversion).c_str(), (unsigned long long)number);
+				break;
+			case 'c':
+				AppendFormatted(out, (spec + conversion).c_str(), (int)number);
+				break;
+			case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+				AppendFormatted(out, (spec + conversion).c_str(), is_string ? 0.0 : arg.AsDouble());
+				break;
+			case 'p':
+				AppendFormatted(out, (spec + conversion).c_str(), (const void *)(uintptr_t)number);
+				break;
+			case 's':
+				if (arg.type == ArgType::WideString || (long_length && !is_string))
+				{
+					std::wstring text(arg.count, L'\0');
+					if (is_string) memcpy(&text[0], arg.characters, arg.count * sizeof(wchar_t));
+					AppendFormatted(out, (spec + "ls").c_str(), text.c_str());
+				}
+				else
+				{
+					const std::string text = is_string ? std::string((const char *)arg.characters, arg.count) : std::string();
+					AppendFormatted(out, (spec + conversion).c_str(), text.c_str());
+				}
+				break;
+			default:
+				break; // %n and anything unknown print nothing
+			}
+		}
+	}
+
+	// Called with `lock` held
+	void Print(const Record &record, std::string &text)
+	{
+		text.clear();
+		Format(record, text);
+
+#ifdef _WIN32
+		// errors stand out in red (the console only has stdout)
+		HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+		CONSOLE_SCREEN_BUFFER_INFO info{};
+		const bool colored = record.level >= Log::Level::Error && GetConsoleScreenBufferInfo(console, &info);
+
+		if (colored)
+		{
+			fflush(stdout);
+			SetConsoleTextAttribute(console, (info.wAttributes & 0xFF00) | FOREGROUND_RED | FOREGROUND_INTENSITY);
+		}
+
+		fwrite(text.data(), 1, text.size(), stdout);
+
+		if (colored)
+		{
+			fflush(stdout);
+			SetConsoleTextAttribute(console, info.wAttributes);
+		}
+#else
+		fwrite(text.data(), 1, text.size(), record.level >= Log::Level::Error ? stderr : stdout);
+#endif
+	}
+
+	// Called with `lock` held
+	void Drain()
+	{
+		struct Pending
+		{
+			const Record *record;
+			ThreadBuffer *buffer;
+		};
+
+		std::vector<Pending> pending;
+		std::vector<size_t> heads(buffers.size());
+
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			ThreadBuffer *buffer = buffers[i];
+			heads[i] = buffer->head.load(std::memory_order_acquire);
+
+			for (size_t position = buffer->tail.load(std::memory_order_relaxed); position != heads[i]; position++)
+				pending.push_back({ &buffer->records[position % ThreadBuffer::Capacity], buffer });
+		}
+
+		// messages from different threads come out in the order they were logged
+		std::sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b)
+		{
+			return a.record->sequence < b.record->sequence;
+		});
+
+		std::string text;
+		for (const auto &entry : pending)
+			Print(*entry.record, text);
+
+		fflush(stdout);
+		fflush(stderr);
+
+		size_t kept = 0;
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			ThreadBuffer *buffer = buffers[i];
+			const bool retired = buffer->retired.load(std::memory_order_acquire);
+			buffer->tail.store(heads[i], std::memory_order_release);
+
+			// a retired thread can't log again, but it may have between our head snapshot and now
+			if (retired && buffer->head.load(std::memory_order_acquire) == heads[i])
+				delete buffer;
+			else
+				buffers[kept++] = buffer;
+		}
+
+		buffers.resize(kept);
+	}
+
+	// False if the writer isn't running, in which case the caller prints the record itself
+	bool Enqueue(const Record &record)
+	{
+		if (!running.load(std::memory_order_acquire))
+			return false;
+
+		ThreadBuffer *buffer = GetThreadBuffer();
+
+		// the ring is full: wait for the writer to catch up rather than lose the message
+		while (!buffer->Push(record))
+		{
+			if (!running.load(std::memory_order_acquire))
+				return false;
+
+			wake.notify_one();
+			std::this_thread::yield();
+		}
+
+		// Stop may have cleared `running` and done its last Drain after the check above, which would strand the record.
+		// Pairs with the fence in Stop: either its Drain sees this push or this sees `running` cleared
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!running.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			Drain();
+			return true;
+		}
+
+		if (record.level >= Log::Level::Error)
+			wake.notify_one(); // errors show up right away
+
+		return true;
+	}
+
+	void WriterMain()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		while (!stopping)
+		{
+			wake.wait_for(guard, std::chrono::milliseconds(50));
+			Drain();
+		}
+	}
+
+	bool ParseLevel(const char *name, size_t length, Log::Level &level)
+	{
+		static const char *const names[] = { "debug", "info", "warning", "error", "off" };
+
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+		{
+			if (strlen(names[i]) == length && strncmp(names[i], name, length) == 0)
+			{
+				level = (Log::Level)i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool ParseSubsystem(const char *name, size_t length, Log::Subsystem &subsystem)
+	{
+		static const char *const names[] = { "general", "procutil", "scan", "attach", "watch" };
+		static_assert(sizeof(names) / sizeof(names[0]) == (size_t)Log::Subsystem::Count, "missing subsystem name");
+
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+		{
+			if (strlen(names[i]) == length && strncmp(names[i], name, length) == 0)
+			{
+				subsystem = (Log::Subsystem)i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+void Log::SetLevel(Level level)
+{
+	for (auto &subsystem_level : Levels)
+		subsystem_level.store(level, std::memory_order_relaxed);
+}
+
+void Log::SetLevel(Subsystem subsystem, Level level)
+{
+	Levels[(size_t)subsystem].store(level, std::memory_order_relaxed);
+}
+
+bool Log::Configure(const char *spec)
+{
+	Level levels[(size_t)Subsystem::Count];
+	for (size_t i = 0; i < (size_t)Subsystem::Count; i++)
+		levels[i] = Levels[i].load(std::memory_order_relaxed);
+
+	while (*spec)
+	{
+		const char *end = strchr(spec, ',');
+		if (!end) end = spec + strlen(spec);
+
+		const char *equals = std::find(spec, end, '=');
+		Level level;
+
+		if (equals == end)
+		{
+			if (!ParseLevel(spec, end - spec, level))
+				return false;
+
+			std::fill(std::begin(levels), std::end(levels), level);
+		}
+		else
+		{
+			Subsystem subsystem;
+			if (!ParseSubsystem(spec, equals - spec, subsystem) || !ParseLevel(equals + 1, end - equals - 1, level))
+				return false;
+
+			levels[(size_t)subsystem] = level;
+		}
+
+		spec = *end ? end + 1 : end;
+	}
+
+	for (size_t i = 0; i < (size_t)Subsystem::Count; i++)
+		Levels[i].store(levels[i], std::memory_order_relaxed);
+
+	return true;
+}
+
+void Log::Start()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (running.load(std::memory_order_relaxed))
+		return;
+
+	stopping = false;
+	running.store(true, std::memory_order_release);
+	writer = std::thread(WriterMain);
+}
+
+void Log::Stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!running.load(std::memory_order_relaxed))
+			return;
+
+		running.store(false, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_seq_cst); // see Enqueue
+		stopping = true;
+	}
+
+	wake.notify_all();
+	writer.join();
+
+	std::lock_guard<std::mutex> guard(lock);
+	Drain(); // anything logged while the writer was finishing
+}
+
+void Log::Flush()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Drain();
+}
+
+void Log::Detail::Submit(Record &record)
+{
+	record.sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+
+	if (Enqueue(record))
+		return;
+
+	std::lock_guard<std::mutex> guard(lock);
+	Drain(); // keeps order with anything buffered before Stop
+	std::string text;
+	Print(record, text);
+	fflush(record.level >= Level::Error ? stderr : stdout);
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <type_traits>
+
+// Leveled console logging for the attach and scan paths. A message is stored as a compact binary record (the format
+// string's pointer followed by its raw arguments) in a ring buffer owned by the calling thread, and only formatted and
+// written, in order, by a background thread, so logging never waits on the console. A message below its subsystem's
+// level costs one relaxed load and its arguments aren't evaluated.
+//
+// Format strings follow printf (minus '*' widths) and must be literals. String arguments are copied, truncated to
+// what fits in the record. Before Start and after Stop, messages are written immediately on the calling thread.
+//
+// RFU_LOG(Info, Attach, "[%p] Process base: %p\n", tag, base)
+#define RFU_LOG(level, subsystem, ...) \
+	do \
+	{ \
+		if (Log::IsEnabled(Log::Subsystem::subsystem, Log::Level::level)) \
+			Log::Write(Log::Subsystem::subsystem, Log::Level::level, __VA_ARGS__); \
+	} \
+	while (0)
+
+namespace Log
+{
+	enum class Level : uint8_t
+	{
+		Debug,
+		Info,
+		Warning,
+		Error,
+		Off
+	};
+
+	enum class Subsystem : uint8_t
+	{
+		General,
+		ProcUtil, // process/module queries and remote writes
+		Scan,
+		Attach,
+		Watch, // process discovery and exit tracking
+		Count
+	};
+
+	extern std::atomic<Level> Levels[(size_t)Subsystem::Count];
+
+	inline bool IsEnabled(Subsystem subsystem, Level level)
+	{
+		return level >= Levels[(size_t)subsystem].load(std::memory_order_relaxed);
+	}
+
+	void SetLevel(Level level); // every subsystem
+	void SetLevel(Subsystem subsystem, Level level);
+
+	// "debug" or "procutil=debug,scan=warning"; returns false, changing nothing, if `spec` doesn't parse
+	bool Configure(const char *spec);
+
+	// Starts the writer thread
+	void Start();
+
+	// Writes out everything logged so far and goes back to writing immediately
+	void Stop();
+
+	// Writes out everything logged so far from the calling thread, e.g. before prompting on the console
+	void Flush();
+
+	namespace Detail
+	{
+		enum class ArgType : uint8_t
+		{
+			Signed,
+			Unsigned,
+			Double,
+			Pointer,
+			String, // followed by a uint16_t length and the characters
+			WideString // same, in wchar_t units
+		};
+
+		struct Record
+		{
+			static const size_t Size = 512;
+
+			uint64_t sequence;
+			const char *format;
+			Subsystem subsystem;
+			Level level;
+			uint16_t length; // bytes of `data` in use
+			uint8_t data[Size - sizeof(uint64_t) - sizeof(const char *) - sizeof(uint32_t)];
+
+			void Append(const void *value, size_t size)
+			{
+				if (size > sizeof(data) - length)
+					size = sizeof(data) - length;
+
+				memcpy(data + length, value, size);
+				length += (uint16_t)size;
+			}
+
+			void AppendScalar(ArgType type, const void *value, size_t size)
+			{
+				if (sizeof(data) - length < 1 + size)
+				{
+					length = sizeof(data); // out of room: this and later arguments are left out
+					return;
+				}
+
+				Append(&type, 1);
+				Append(value, size);
+			}
+
+			static size_t Length(const char *value, size_t limit) { return strnlen(value, limit); }
+			static size_t Length(const wchar_t *value, size_t limit) { return wcsnlen(value, limit); }
+
+			template <typename Char>
+			void AppendString(ArgType type, const Char *value)
+			{
+				if (sizeof(data) - length < 1 + sizeof(uint16_t))
+				{
+					length = sizeof(data);
+					return;
+				}
+
+				const size_t room = (sizeof(data) - length - 1 - sizeof(uint16_t)) / sizeof(Char);
+				const size_t count = value ? Length(value, room) : 0;
+
+				const uint16_t units = (uint16_t)count;
+				Append(&type, 1);
+				Append(&units, sizeof(units));
+				Append(value, count * sizeof(Char));
+			}
+		};
+
+		template <typename T>
+		void Encode(Record &record, T value)
+		{
+			if constexpr (std::is_same_v<T, const char *> || std::is_same_v<T, char *>)
+			{
+				record.AppendString(ArgType::String, value ? value : "(null)");
+			}
+			else if constexpr (std::is_same_v<T, const wchar_t *> || std::is_same_v<T, wchar_t *>)
+			{
+				record.AppendString(ArgType::WideString, value ? value : L"(null)");
+			}
+			else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>)
+			{
+				const uint64_t address = (uint64_t)(uintptr_t)(const void *)value;
+				record.AppendScalar(ArgType::Pointer, &address, sizeof(address));
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				const double number = (double)value;
+				record.AppendScalar(ArgType::Double, &number, sizeof(number));
+			}
+			else if constexpr (std::is_enum_v<T>)
+			{
+				Encode(record, (std::underlying_type_t<T>)value);
+			}
+			else if constexpr (std::is_signed_v<T>)
+			{
+				const int64_t number = (int64_t)value;
+				record.AppendScalar(ArgType::Signed, &number, sizeof(number));
+			}
+			else
+			{
+				static_assert(std::is_unsigned_v<T>, "unsupported log argument");
+				const uint64_t number = (uint64_t)value;
+				record.AppendScalar(ArgType::Unsigned, &number, sizeof(number));
+			}
+		}
+
+		void Submit(Record &record);
+	}
+
+	template <typename... Args>
+	void Write(Subsystem subsystem, Level level, const char *format, Args... args)
+	{
+		Detail::Record record;
+		record.format = format;
+		record.subsystem = subsystem;
+		record.level = level;
+		record.length = 0;
+		(Detail::Encode(record, args), ...);
+		Detail::Submit(record);
+	}
+}
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <unordered_set>
 #include <chrono>
 #include <fstream>
+#include <memory>
 #include <TlHelp32.h>
 #include <winternl.h>
 
@@ -16,25 +17,23 @@
 #include "settings.h"
 #include "rfu.h"
 #include "procutil.h"
-#include "sigscan.h"
-#include "nlohmann.hpp"
+#include "robloxprocess.h"
+#include "attachpipeline.h"
+#include "exitwatcher.h"
+#include "phasestats.h"
+#include "log.h"
+#include "metrics.h"
+#include "trace.h"
 
 #define ROBLOX_BASIC_ACCESS (PROCESS_QUERY_INFORMATION | PROCESS_VM_READ)
 #define	ROBLOX_WRITE_ACCESS (PROCESS_QUERY_INFORMATION | PROCESS_VM_OPERATION | PROCESS_VM_READ | PROCESS_VM_WRITE)
 
 HANDLE SingletonMutex;
 
-enum class RobloxHandleType
-{
-	None,
-	Client,
-	UWP,
-	Studio
-};
-
 struct RobloxProcessHandle
 {
 	DWORD id;
+	uint64_t start_time = 0; // see ProcUtil::ProcessMatch
 	HANDLE handle;
 	RobloxHandleType type;
 	bool can_write;
@@ -50,6 +49,7 @@ struct RobloxProcessHandle
 	RobloxProcessHandle(RobloxProcessHandle &&other) noexcept
 	{
 		std::swap(id, other.id);
+		std::swap(start_time, other.start_time);
 		std::swap(handle, other.handle);
 		std::swap(type, other.type);
 		std::swap(can_write, other.can_write);
@@ -61,6 +61,7 @@ struct RobloxProcessHandle
 		{
 			if (handle) CloseHandle(handle);
 			id = std::exchange(other.id, {});
+			start_time = std::exchange(other.start_time, {});
 			handle = std::exchange(other.handle, {});
 			type = std::exchange(other.type, {});
 			can_write = std::exchange(other.can_write, {});
@@ -112,37 +113,75 @@ struct RobloxProcessHandle
 		return true;
 	}
 
-	template <typename T>
-	void Write(const void *location, const T &value) const
+	bool Write(const void *location, const void *buffer, size_t size) const
 	{
 		if (can_write)
 		{
-			printf("[%p] Writing to %p\n", handle, location);
-			ProcUtil::Write<T>(handle, location, value);
+			RFU_LOG(Debug, ProcUtil, "[%p] Writing to %p\n", handle, location);
+			return WriteProcessMemory(handle, (LPVOID) location, buffer, size, NULL) != 0;
 		}
 		else
 		{
 			auto write_handle = CreateWriteHandle();
-			if (!write_handle) throw ProcUtil::WindowsException("failed to create write handle");
-			printf("[%p] Writing to %p with handle %p\n", handle, location, write_handle);
-			ProcUtil::Write<T>(write_handle, location, value);
+			if (!write_handle) return false;
+			RFU_LOG(Debug, ProcUtil, "[%p] Writing to %p with handle %p\n", handle, location, write_handle);
+			const bool result = WriteProcessMemory(write_handle, (LPVOID) location, buffer, size, NULL) != 0;
+			const DWORD error = GetLastError();
 			CloseHandle(write_handle);
+			SetLastError(error);
+			return result;
 		}
 	}
 };
 
+// Win32MemorySource that owns the process handle and writes through RobloxProcessHandle::Write
+class RobloxMemorySource : public ProcUtil::Win32MemorySource
+{
+public:
+	explicit RobloxMemorySource(RobloxProcessHandle handle)
+		: Win32MemorySource(handle.handle), process(std::move(handle))
+	{
+	}
+
+	const RobloxProcessHandle &GetHandle() const
+	{
+		return process;
+	}
+
+	bool Write(const void *address, const void *buffer, size_t size) override
+	{
+		return process.Write(address, buffer, size);
+	}
+
+private:
+	RobloxProcessHandle process;
+};
+
 std::vector<RobloxProcessHandle> GetRobloxProcesses(bool open_all = true, bool include_client = true, bool include_studio = true)
 {
-	std::vector<RobloxProcessHandle> result;
+	std::vector<const char *> image_names;
+	std::vector<RobloxHandleType> types;
+
 	if (include_client)
 	{
-		for (auto pid : ProcUtil::GetProcessIdsByImageName("RobloxPlayerBeta.exe")) result.emplace_back(pid, RobloxHandleType::Client, open_all);
-		for (auto pid : ProcUtil::GetProcessIdsByImageName("Windows10Universal.exe")) result.emplace_back(pid, RobloxHandleType::UWP, open_all);
+		image_names.push_back("RobloxPlayerBeta.exe");
+		types.push_back(RobloxHandleType::Client);
+		image_names.push_back("Windows10Universal.exe");
+		types.push_back(RobloxHandleType::UWP);
 	}
 	if (include_studio)
 	{
-		for (auto pid : ProcUtil::GetProcessIdsByImageName("RobloxStudioBeta.exe")) result.emplace_back(pid, RobloxHandleType::Studio, open_all);
+		image_names.push_back("RobloxStudioBeta.exe");
+		types.push_back(RobloxHandleType::Studio);
+	}
+
+	std::vector<RobloxProcessHandle> result;
+	for (const auto &match : ProcUtil::FindProcessesByImageNames(image_names))
+	{
+		result.emplace_back(match.id, types[match.image], open_all);
+		result.back().start_time = match.start_time;
 	}
+
 	return result;
 }
 
@@ -201,17 +240,7 @@ void NotifyError(const char* title, const char* error)
 {
 	if (Settings::SilentErrors || Settings::NonBlockingErrors)
 	{
-		// lol
-		HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
-		CONSOLE_SCREEN_BUFFER_INFO info{};
-		GetConsoleScreenBufferInfo(console, &info);
-
-		WORD color = (info.wAttributes & 0xFF00) | FOREGROUND_RED | FOREGROUND_INTENSITY;
-		SetConsoleTextAttribute(console, color);
-
-		printf("[ERROR] %s\n", error);
-
-		SetConsoleTextAttribute(console, info.wAttributes);
+		RFU_LOG(Error, General, "[ERROR] %s\n", error); // shown in red
 
 		if (!Settings::SilentErrors)
 		{
@@ -220,468 +249,52 @@ void NotifyError(const char* title, const char* error)
 	}
 	else
 	{
-		MessageBoxA(UI::Window, error, title, MB_OK);
+		UI::ShowMessage(title, error, MB_OK);
 	}
 }
 
-class RobloxProcess
+void NotifyInfo(const char *title, const char *message)
 {
-	RobloxProcessHandle process{};
-	ProcUtil::ModuleInfo main_module{};
-	std::vector<const void *> ts_ptr_candidates; // task scheduler pointer candidates
-	const void *fd_ptr = nullptr; // frame delay pointer
-	bool use_flags_file = false;
-	int retries_left = 0;
-
-	bool BlockingLoadModuleInfo()
-	{
-		int tries = 5;
-		int wait_time = 100;
-
-		printf("[%p] Finding process base...\n", process.handle);
-
-		while (true)
-		{
-			ProcUtil::ProcessInfo info = ProcUtil::ProcessInfo(process.handle);
-
-			if (info.module.base != nullptr)
-			{
-				main_module = info.module;
-				return true;
-			}
-
-			if (tries--)
-			{
-				printf("[%p] Retrying in %dms...\n", process.handle, wait_time);
-				Sleep(wait_time);
-				wait_time *= 2;
-			} else
-			{
-				return false;
-			}
-		}
-	}
-
-	bool IsLikelyAntiCheatProtected() const
-	{
-		return process.type != RobloxHandleType::Studio && ProcUtil::IsProcess64Bit(process.handle);
-	}
-
-	std::filesystem::path GetClientAppSettingsFilePath() const
-	{
-		return main_module.path.parent_path() / "ClientSettings" / "ClientAppSettings.json";
-	}
-
-	std::optional<int> FetchTargetFpsDiskValue(nlohmann::json *object_out = nullptr) const
-	{
-		std::ifstream file(GetClientAppSettingsFilePath());
-
-		if (file.is_open())
-		{
-			nlohmann::json object = nlohmann::json::parse(file, nullptr, false);
-			if (!object.is_discarded())
-			{
-				std::optional<int> result{};
-
-				if (object.contains("DFIntTaskSchedulerTargetFps"))
-				{
-					auto target_fps = object["DFIntTaskSchedulerTargetFps"];
-					if (target_fps.is_number_integer())
-					{
-						result = target_fps.get<int>();
-					}
-				}
-
-				if (object_out)
-					*object_out = std::move(object);
-
-				return result;
-			}
-		}
-
-		return std::nullopt;
-	}
-
-	bool IsTargetFpsFlagActive() const
-	{
-		auto value = FetchTargetFpsDiskValue();
-		return value.has_value() && *value > 0;
-	}
-
-	void WriteFlagsFile(int cap)
-	{
-		// todo: add support for registry read
-
-		if (cap == 0) cap = 5588562;
-
-		auto settings_file_path = GetClientAppSettingsFilePath();
-		printf("[%p] Updating DFIntTaskSchedulerTargetFps in %ls to %d\n", process.handle, settings_file_path.c_str(), cap);
-
-		nlohmann::json object{};
-
-		// read
-		auto current_cap = FetchTargetFpsDiskValue(&object);
-		if ((current_cap.has_value() && *current_cap == cap) || (!current_cap.has_value() && cap < 0))
-		{
-			return;
-		}
-
-		// update
-		object["DFIntTaskSchedulerTargetFps"] = cap;
-
-		// try write
-		{
-			std::error_code ec{};
-			std::filesystem::create_directory(settings_file_path.parent_path(), ec);
-
-			std::ofstream file(settings_file_path);
-			if (!file.is_open())
-			{
-				NotifyError("rbxfpsunlocker Error", "Failed to write ClientAppSettings.json! If running the Windows Store version of Roblox, try running Roblox FPS Unlocker as administrator or using a different unlock method.");
-				return;
-			}
-			file << object.dump(4);
-		}
-
-		// prompt
-		char message[512]{};
-		sprintf_s(message, "Set DFIntTaskSchedulerTargetFps to %d in %ls\n\nRestarting Roblox may be required for changes to take effect.", cap, settings_file_path.c_str());
-		MessageBoxA(UI::Window, message, "rbxfpsunlocker", MB_OK | MB_ICONINFORMATION | MB_SETFOREGROUND);
-	}
-
-	void SetFPSCapInMemory(double cap)
-	{
-		if (fd_ptr)
-		{
-			try
-			{
-				static const double min_frame_delay = 1.0 / 10000.0;
-				double frame_delay = cap <= 0.0 ? min_frame_delay : 1.0 / cap;
-
-				process.Write(fd_ptr, frame_delay);
-			} catch (ProcUtil::WindowsException &e)
-			{
-				printf("[%p] RobloxProcess::SetFPSCapInMemory failed: %s (%d)\n", process.handle, e.what(), e.GetLastError());
-			}
-		}
-	}
-
-	bool FindTaskScheduler()
-	{
-		try
-		{
-			const auto handle = process.handle;
-			const auto start = (const uint8_t *)main_module.base;
-			const auto end = start + main_module.size;
-
-			if (ProcUtil::IsProcess64Bit(handle))
-			{
-				// 40 53 48 83 EC 20 0F B6 D9 E8 ?? ?? ?? ?? 86 58 04 48 83 C4 20 5B C3
-				if (auto result = (const uint8_t *)ProcUtil::ScanProcess(handle, "\x40\x53\x48\x83\xEC\x20\x0F\xB6\xD9\xE8\x00\x00\x00\x00\x86\x58\x04\x48\x83\xC4\x20\x5B\xC3", "xxxxxxxxxx????xxxxxxxxx", start, end))
-				{
-					auto gts_fn = result + 14 + ProcUtil::Read<int32_t>(handle, result + 10);
-
-					printf("[%p] GetTaskScheduler (sig studio): %p\n", handle, gts_fn);
-
-					uint8_t buffer[0x100];
-					if (ProcUtil::Read(handle, gts_fn, buffer, sizeof(buffer)))
-					{
-						if (auto inst = sigscan::scan("\x48\x8B\x05\x00\x00\x00\x00\x48\x83\xC4\x28", "xxx????xxxx", (uintptr_t)buffer, (uintptr_t)buffer + 0x100)) // mov eax, <TaskSchedulerPtr>; mov ecx, [ebp-0Ch])
-						{
-							const uint8_t *remote = gts_fn + (inst - buffer);
-							ts_ptr_candidates = { remote + 7 + *(int32_t *)(inst + 3) };
-							return true;
-						}
-					}
-				}
-				else
-				{
-					// Assume Byfron
-					// 
-					// Thought process: Fancy new anti-cheat technology makes inspecting .text a bit more troublesome than before
-					// As a result, I've opted to sig GetTaskScheduler directly instead of looking for one its callers.
-					// A longer, uglier signature could be used to produce a single result here,
-					// but for the sake of (hopefully) increased reliability, we'll use a simple signature that returns about 8 candidates in a loaded game.
-
-					std::unordered_set<const void *> candidates{};
-					auto i = start;
-					auto stop = (std::min)(end, start + 40 * 1024 * 1024); // optim: keep search roughly within .text
-					const size_t candidate_threshold = 5;
-
-					while (i < stop)
-					{
-						// 48 8B 05 ?? ?? ?? ?? 48 83 C4 48 C3
-						auto result = (const uint8_t *)ProcUtil::ScanProcess(handle, "\x48\x8B\x05\x00\x00\x00\x00\x48\x83\xC4\x48\xC3", "xxx????xxxxx", i, stop); // mov rax, <Rel32>; add rsp, 48h; retn
-						if (!result) break;
-						candidates.insert(result + 7 + ProcUtil::Read<int32_t>(handle, result + 3));
-						if (candidates.size() >= candidate_threshold) break;
-						i = result + 1;
-					}
-
-					printf("[%p] GetTaskScheduler (sig byfron): found %zu candidates\n", handle, candidates.size());
-
-					if (candidates.size() != candidate_threshold)
-						return false; // keep looking
-
-					ts_ptr_candidates = std::vector<const void *>(candidates.begin(), candidates.end());
-					return true;
-				}
-			} else
-			{
-				// 55 8B EC 83 E4 F8 83 EC 08 E8 ?? ?? ?? ?? 8D 0C 24
-				if (auto result = (const uint8_t *)ProcUtil::ScanProcess(handle, "\x55\x8B\xEC\x83\xE4\xF8\x83\xEC\x08\xE8\xDE\xAD\xBE\xEF\x8D\x0C\x24", "xxxxxxxxxx????xxx", start, end))
-				{
-					auto gts_fn = result + 14 + ProcUtil::Read<int32_t>(handle, result + 10);
-
-					printf("[%p] GetTaskScheduler (sig ltcg): %p\n", handle, gts_fn);
-
-					uint8_t buffer[0x100];
-					if (ProcUtil::Read(handle, gts_fn, buffer, sizeof(buffer)))
-					{
-						if (auto inst = sigscan::scan("\xA1\x00\x00\x00\x00\x8B\x4D\xF4", "x????xxx", (uintptr_t)buffer, (uintptr_t)buffer + 0x100)) // mov eax, <TaskSchedulerPtr>; mov ecx, [ebp-0Ch])
-						{
-							//printf("[%p] Inst: %p\n", process, gts_fn + (inst - buffer));
-							ts_ptr_candidates = { (const void *)(*(uint32_t *)(inst + 1)) };
-							return true;
-						}
-					}
-				}
-				// 55 8B EC 83 EC 10 56 E8 ?? ?? ?? ?? 8B F0 8D 45 F0
-				else if (auto result = (const uint8_t *)ProcUtil::ScanProcess(handle, "\x55\x8B\xEC\x83\xEC\x10\x56\xE8\x00\x00\x00\x00\x8B\xF0\x8D\x45\xF0", "xxxxxxxx????xxxxx", start, end))
-				{
-					auto gts_fn = result + 12 + ProcUtil::Read<int32_t>(handle, result + 8);
-
-					printf("[%p] GetTaskScheduler (sig non-ltcg): %p\n", handle, gts_fn);
-
-					uint8_t buffer[0x100];
-					if (ProcUtil::Read(handle, gts_fn, buffer, sizeof(buffer)))
-					{
-						if (auto inst = sigscan::scan("\xA1\x00\x00\x00\x00\x8B\x4D\xF4", "x????xxx", (uintptr_t)buffer, (uintptr_t)buffer + 0x100)) // mov eax, <TaskSchedulerPtr>; mov ecx, [ebp-0Ch])
-						{
-							//printf("[%p] Inst: %p\n", process, gts_fn + (inst - buffer));
-							ts_ptr_candidates = { (const void *)(*(uint32_t *)(inst + 1)) };
-							return true;
-						}
-					}
-				}
-				// 55 8B EC 83 E4 F8 83 EC 14 56 E8 ?? ?? ?? ?? 8D 4C 24 10
-				else if (auto result = (const uint8_t *)ProcUtil::ScanProcess(handle, "\x55\x8B\xEC\x83\xE4\xF8\x83\xEC\x14\x56\xE8\x00\x00\x00\x00\x8D\x4C\x24\x10", "xxxxxxxxxxx????xxxx", start, end))
-				{
-					auto gts_fn = result + 15 + ProcUtil::Read<int32_t>(handle, result + 11);
-
-					printf("[%p] GetTaskScheduler (sig uwp): %p\n", handle, gts_fn);
-
-					uint8_t buffer[0x100];
-					if (ProcUtil::Read(handle, gts_fn, buffer, sizeof(buffer)))
-					{
-						if (auto inst = sigscan::scan("\xA1\x00\x00\x00\x00\x8B\x4D\xF4", "x????xxx", (uintptr_t)buffer, (uintptr_t)buffer + 0x100)) // mov eax, <TaskSchedulerPtr>; mov ecx, [ebp-0Ch])
-						{
-							ts_ptr_candidates = { (const void *)(*(uint32_t *)(inst + 1)) };
-							return true;
-						}
-					}
-				}
-			}
-		}
-		catch (ProcUtil::WindowsException &e)
-		{
-		}
-
-		return false;
-	}
-
-	size_t FindTaskSchedulerFrameDelayOffset(const void *scheduler) const
-	{
-		const size_t search_offset = 0x100; // ProcUtil::IsProcess64Bit(process) ? 0x200 : 0x100;
-
-		uint8_t buffer[0x100];
-		if (!ProcUtil::Read(process.handle, (const uint8_t *)scheduler + search_offset, buffer, sizeof(buffer)))
-			return -1;
-
-		/* Find the frame delay variable inside TaskScheduler (ugly, but it should survive updates unless the variable is removed or shifted)
-		   (variable was at +0x150 (32-bit) and +0x180 (studio 64-bit) as of 2/13/2020) */
-		for (int i = 0; i < sizeof(buffer) - sizeof(double); i += 4)
-		{
-			static const double frame_delay = 1.0 / 60.0;
-			double difference = *(double *)(buffer + i) - frame_delay;
-			difference = difference < 0 ? -difference : difference;
-			if (difference < std::numeric_limits<double>::epsilon()) return search_offset + i;
-		}
-
-		return -1;
-	}
-
-public:
-	const RobloxProcessHandle &GetHandle() const
-	{
-		return process;
-	}
-
-	bool Attach(RobloxProcessHandle handle, int retry_count)
-	{
-		process = std::move(handle);
-		retries_left = retry_count;
-
-		if (!BlockingLoadModuleInfo())
-		{
-			NotifyError("rbxfpsunlocker Error", "Failed to get process base! Restart Roblox FPS Unlocker or, if you are on a 64-bit operating system, make sure you are using the 64-bit version of Roblox FPS Unlocker.");
-			retries_left = -1;
-			return false;
-		}
-		else
-		{
-			printf("[%p] Process base: %p (size %zu)\n", process.handle, main_module.base, main_module.size);
-
-			// Small windows exist where we can attach to Roblox's security daemon while it isn't being debugged (see GetRobloxProcesses)
-			// As a secondary measure, check module size (daemon is about 1MB, client is about 80MB)
-			if (main_module.size < 1024 * 1024 * 10)
-			{
-				printf("[%p] Ignoring security daemon process\n", process.handle);
-				retries_left = -1;
-				return false;
-			}
-
-			OnUnlockMethodUpdate();
-			Tick();
-
-			return !ts_ptr_candidates.empty() && fd_ptr != nullptr;
-		}
-	}
-
-	void Tick()
-	{
-		if (use_flags_file)
-			return;
-
-		if (retries_left < 0)
-			return; // we tried
-
-		if (ts_ptr_candidates.empty())
-		{
-			const auto start_time = std::chrono::steady_clock::now();
-			FindTaskScheduler();
-			
-			if (ts_ptr_candidates.empty())
-			{
-				if (retries_left-- <= 0)
-					NotifyError("rbxfpsunlocker Error", "Unable to find TaskScheduler! This is probably due to a Roblox update-- watch the github for any patches or a fix.");
-				return;
-			}
-			else
-			{
-				const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
-				printf("[%p] Found TaskScheduler candidates in %lldms\n", process.handle, elapsed);
-			}
-		}
-
-		if (!ts_ptr_candidates.empty() && !fd_ptr)
-		{
-			try
-			{
-				size_t fail_count = 0;
-
-				for (const void *ts_ptr : ts_ptr_candidates)
-				{
-					if (auto scheduler = (const uint8_t *)(ProcUtil::ReadPointer(process.handle, ts_ptr)))
-					{
-						printf("[%p] Potential task scheduler: %p\n", process.handle, scheduler);
-
-						size_t delay_offset = FindTaskSchedulerFrameDelayOffset(scheduler);
-						if (delay_offset == -1)
-						{
-							fail_count++;
-							continue; // try next
-						}
-
-						// winner
-						printf("[%p] Frame delay offset: %zu (0x%zx)\n", process.handle, delay_offset, delay_offset);
-						fd_ptr = scheduler + delay_offset;
-
-						// first write
-						SetFPSCap(Settings::FPSCap);
-						return;
-					}
-					else
-					{
-						printf("[%p] *ts_ptr (%p) == nullptr\n", process.handle, ts_ptr);
-					}
-				}
-
-				if (fail_count > 0)
-				{
-					// one or more candidates had valid pointers with no frame delay variable
-					if (retries_left-- <= 0)
-						NotifyError("rbxfpsunlocker Error", "Variable scan failed! Make sure your framerate is at ~60.0 FPS (press Shift+F5 in-game) before using Roblox FPS Unlocker.");
-				}
-			}
-			catch (ProcUtil::WindowsException& e)
-			{
-				printf("[%p] RobloxProcess::Tick failed: %s (%d)\n", process.handle, e.what(), e.GetLastError());
-				if (retries_left-- <= 0)
-					NotifyError("rbxfpsunlocker Error", "An exception occurred while performing the variable scan.");
-			}
-		}
-	}
-
-	void SetFPSCap(double cap)
-	{
-		if (use_flags_file)
-		{
-			WriteFlagsFile(cap);
-		}
-		else
-		{
-			SetFPSCapInMemory(cap);
-		}
-	}
+	UI::ShowMessage(title, message, MB_OK | MB_ICONINFORMATION | MB_SETFOREGROUND);
+}
 
-	void OnUIClose()
-	{
-		SetFPSCapInMemory(60.0);
-	}
+AttachPipeline &GetPipeline()
+{
+	// never destroyed, so exiting doesn't have to join the pool's threads
+	static auto *pipeline = new AttachPipeline();
+	return *pipeline;
+}
 
-	void OnUnlockMethodUpdate()
-	{
-		if (Settings::UnlockMethod == Settings::UnlockMethodType::FlagsFile
-			|| (Settings::UnlockMethod == Settings::UnlockMethodType::Hybrid && IsLikelyAntiCheatProtected()))
-		{
-			printf("[%p] Using FlagsFile mode\n", process.handle);
-			use_flags_file = true;
-			WriteFlagsFile(Settings::FPSCap);
-		}
-		else
-		{
-			printf("[%p] Using MemoryWrite mode\n", process.handle);
-			if (use_flags_file || IsTargetFpsFlagActive()) WriteFlagsFile(-1);
-			use_flags_file = false;
-		}
-	}
-};
+bool QuitRequested = false; // only touched on the watch thread, set by the command RFU_OnUIClose posts
 
-std::unordered_map<DWORD, RobloxProcess> AttachedProcesses;
+// UI thread: changes are posted to the watch thread, which owns every process, and reach them as soon as it wakes
 
 void RFU_SetFPSCap(double value)
 {
-	for (auto& it : AttachedProcesses)
+	GetPipeline().PostForEach([value](RobloxProcess &process)
 	{
-		it.second.SetFPSCap(value);
-	}
+		process.SetFPSCap(value);
+	});
 }
 
 void RFU_OnUIUnlockMethodChange()
 {
-	for (auto &it : AttachedProcesses)
+	GetPipeline().PostForEach([](RobloxProcess &process)
 	{
-		it.second.OnUnlockMethodUpdate();
-	}
+		process.OnUnlockMethodUpdate();
+	});
 }
 
+// The watch thread restores every process and returns; wait for it before exiting
 void RFU_OnUIClose()
 {
-	for (auto &it : AttachedProcesses)
+	GetPipeline().Post([]()
 	{
-		it.second.OnUIClose();
-	}
+		QuitRequested = true;
+
+		// stop attaches in progress first so restoring 60 FPS doesn't wait behind a scan
+		GetPipeline().CancelAll();
+	});
 }
 
 void pause()
@@ -692,56 +305,81 @@ void pause()
 
 DWORD WINAPI WatchThread(LPVOID)
 {
-	printf("Watch thread started\n");
+	RFU_LOG(Info, Watch, "Watch thread started\n");
+	Trace::SetThreadName("watch");
+
+	auto &pipeline = GetPipeline();
+	ExitWatcher exit_watcher([&pipeline]() { pipeline.Wake(); });
 
-	while (1)
+	while (!QuitRequested)
 	{
+		Trace::Span tick_span("Tick", "watch");
+
 		{
+			PhaseStats::Timer enumerate_timer(PhaseStats::Phase::Enumerate);
 			auto processes = GetRobloxProcesses(false, Settings::UnlockClient, Settings::UnlockStudio);
+			enumerate_timer.Stop();
 
 			for (auto &process : processes)
 			{
 				auto id = process.id;
-				if (AttachedProcesses.find(id) == AttachedProcesses.end())
+				if (!pipeline.Contains(id, process.start_time))
 				{
 					assert(!process.IsOpen());
 					process.Open();
-					printf("Injecting into new process %p (pid %d)\n", process.handle, id);
+					RFU_LOG(Info, Watch, "Injecting into new process %p (pid %d)\n", process.handle, id);
+
+					const auto type = process.type;
+					const auto start_time = process.start_time;
+					pipeline.Add(id, start_time, std::make_unique<RobloxMemorySource>(std::move(process)), type, 5);
 
-					RobloxProcess roblox_process;
-					roblox_process.Attach(std::move(process), 5);
-					AttachedProcesses[id] = std::move(roblox_process);
+					exit_watcher.Unwatch(id); // may still be watching the process that had this pid before
+					if (!exit_watcher.Watch(id))
+						RFU_LOG(Warning, Watch, "Unable to watch pid %d for exit, polling it instead\n", id);
 
-					printf("New size: %zu\n", AttachedProcesses.size());
+					RFU_LOG(Info, Watch, "New size: %zu\n", pipeline.GetCount());
 				}
 			}
 		}
 
-		for (auto it = AttachedProcesses.begin(); it != AttachedProcesses.end();)
+		// processes that exited are no longer watched once taken, so anything still watched is alive and only the rest need their exit code checked
+		exit_watcher.TakeExited();
+
+		pipeline.RemoveIf([&exit_watcher](AttachPipeline::Id id, AttachPipeline::StartTime, RobloxProcess &roblox_process)
 		{
-			auto &process = it->second.GetHandle();
+			if (exit_watcher.IsWatching(id))
+				return false;
+
+			auto &process = static_cast<RobloxMemorySource &>(roblox_process.GetMemory()).GetHandle();
 
 			DWORD code;
 			BOOL result = GetExitCodeProcess(process.handle, &code);
 
 			if (code != STILL_ACTIVE)
 			{
-				printf("Purging dead process %p (pid %d, code %X)\n", process.handle, GetProcessId(process.handle), code);
-				it = AttachedProcesses.erase(it);
-				printf("New size: %zu\n", AttachedProcesses.size());
-			}
-			else
-			{
-				it->second.Tick();
-				it++;
+				RFU_LOG(Info, Watch, "Purging dead process %p (pid %d, code %X)\n", process.handle, GetProcessId(process.handle), code);
+				return true;
 			}
-		}
 
-		UI::AttachedProcessesCount = AttachedProcesses.size();
+			return false;
+		});
+
+		UI::AttachedProcessesCount = pipeline.GetCount();
+		Metrics::SetAttachedProcesses(pipeline.GetCount());
+		tick_span.Stop();
 
-		Sleep(2000);
+		// new processes are looked for every second; in between, the thread only wakes when a process' next step is due or one exits
+		pipeline.DispatchUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(1000));
 	}
 
+	RFU_LOG(Info, Watch, "Restoring processes and exiting\n");
+
+	pipeline.ForEach([](RobloxProcess &process)
+	{
+		process.OnUIClose();
+	});
+	pipeline.WaitIdle();
+
 	return 0;
 }
 
@@ -768,6 +406,27 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 		return 0;
 	}
 
+	if (strstr(lpCmdLine, "--benchmark"))
+	{
+		UI::IsConsoleOnly = true;
+		UI::ToggleConsole();
+		RunScanBenchmark();
+		pause();
+		return 0;
+	}
+
+	// e.g. --log debug or --log procutil=debug,scan=warning
+	if (const char *log_spec = strstr(lpCmdLine, "--log "))
+	{
+		log_spec += strlen("--log ");
+		const std::string spec(log_spec, strcspn(log_spec, " "));
+		Log::Configure(spec.c_str());
+	}
+
+	// timeline of scans and attach steps for ui.perfetto.dev, written to the working directory
+	if (strstr(lpCmdLine, "--trace") && !Trace::Start("rbxfpsunlocker-trace.json"))
+		printf("Unable to create rbxfpsunlocker-trace.json\n");
+
 	UI::IsConsoleOnly = strstr(lpCmdLine, "--console") != nullptr;
 
 	if (UI::IsConsoleOnly)
@@ -789,7 +448,8 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 		printf("Found Roblox...\n");
 		printf("Attaching...\n");
 
-		if (!attacher.Attach(std::move(process), 0))
+		const auto type = process.type;
+		if (!attacher.Attach(std::make_unique<RobloxMemorySource>(std::move(process)), type, 0))
 		{
 			printf("\nERROR: unable to attach to process\n");
 			pause();
@@ -798,6 +458,7 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 
 		printf("\nSuccess! The injector will close in 3 seconds...\n");
 
+		Trace::Stop();
 		Sleep(3000);
 
 		return 0;
@@ -830,7 +491,16 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 #endif
 			}
 
-			return UI::Start(hInstance, WatchThread);
+			// Prometheus text for fleet monitoring on \\.\pipe\rbxfpsunlocker-metrics
+			if (strstr(lpCmdLine, "--metrics") && !Metrics::Start())
+				printf("Unable to serve metrics on %s\n", Metrics::DefaultEndpoint);
+
+			Log::Start();
+			const int result = UI::Start(hInstance, WatchThread);
+			Metrics::Stop();
+			Log::Stop();
+			Trace::Stop();
+			return result;
 		}
 	}
-} 
+} 
\ No newline at end of file
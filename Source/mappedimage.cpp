@@ -0,0 +1,185 @@
+#include "mappedimage.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedImage::MappedImage(const std::filesystem::path &path, const void *base)
+	: base((const uint8_t *)base)
+{
+#ifdef _WIN32
+	file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER file_size{};
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+	{
+		Close();
+		return;
+	}
+
+	mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		Close();
+		return;
+	}
+
+	data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)file_size.QuadPart;
+#else
+	fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	struct stat info{};
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return;
+	}
+
+	void *view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view != MAP_FAILED)
+	{
+		data = (const uint8_t *)view;
+		size = (size_t)info.st_size;
+	}
+#endif
+
+	if (!data || !PE::ParseHeaders(data, size, headers))
+	{
+		Close();
+		return;
+	}
+
+	// headers, then each section's file-backed part (anything past raw_size is zero-filled at load and not scanned)
+	extents.push_back({ 0, (uint32_t)(std::min)((size_t)headers.size_of_headers, size), 0, false });
+
+	for (const auto &section : headers.sections)
+	{
+		if (section.raw_offset >= size)
+			continue;
+
+		uint32_t length = (std::min)((size_t)section.raw_size, size - section.raw_offset);
+		if (section.virtual_size) length = (std::min)(length, section.virtual_size);
+
+		if (length)
+			extents.push_back({ section.virtual_address, length, section.raw_offset, section.IsCode() });
+	}
+
+	std::sort(extents.begin(), extents.end(), [](const Extent &a, const Extent &b) { return a.rva < b.rva; });
+}
+
+MappedImage::~MappedImage()
+{
+	Close();
+}
+
+void MappedImage::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data) munmap((void *)data, size);
+	if (fd >= 0) close(fd);
+	fd = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+	extents.clear();
+}
+
+std::pair<const uint8_t *, const uint8_t *> MappedImage::GetCodeRange() const
+{
+	uint32_t start = UINT32_MAX, end = 0;
+
+	for (const auto &extent : extents)
+	{
+		if (!extent.is_code) continue;
+		start = (std::min)(start, extent.rva);
+		end = (std::max)(end, extent.rva + extent.size);
+	}
+
+	if (start >= end)
+		return { base, base + headers.size_of_image };
+
+	return { base + start, base + end };
+}
+
+const uint8_t *MappedImage::Get(const void *address, size_t length)
+{
+	const auto target = (const uint8_t *)address;
+	if (!data || target < base || length == 0)
+		return nullptr;
+
+	const size_t rva = target - base;
+
+	for (const auto &extent : extents)
+	{
+		if (rva >= extent.rva && rva - extent.rva < extent.size && length <= extent.size - (rva - extent.rva))
+			return data + extent.file_offset + (rva - extent.rva);
+	}
+
+	return nullptr;
+}
+
+intptr_t MappedImage::GetRelocationDelta() const
+{
+	return (intptr_t)((uintptr_t)base - (uintptr_t)headers.image_base);
+}
+
+// Feeds the file-backed parts of [start, end) to the scanner, addressed where they'd be loaded
+bool MappedImage::Feed(sigscan::stream_scanner &scanner, const uint8_t *start, const uint8_t *end) const
+{
+	for (const auto &extent : extents)
+	{
+		const uint8_t *extent_start = (std::max)(start, base + extent.rva);
+		const uint8_t *extent_end = (std::min)(end, base + extent.rva + extent.size);
+		if (extent_start >= extent_end)
+			continue;
+
+		const uint8_t *local = data + extent.file_offset + (extent_start - (base + extent.rva));
+		if (!scanner.feed(local, extent_end - extent_start, (uintptr_t)extent_start))
+			return false;
+	}
+
+	return true;
+}
+
+bool MappedImage::ScanAll(const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start, const uint8_t *end)
+{
+	const sigscan::pattern pattern(aob, mask);
+	sigscan::stream_scanner scanner(pattern, [&](size_t, uintptr_t address, const uint8_t *local)
+	{
+		return callback((const uint8_t *)address, local);
+	});
+
+	return Feed(scanner, start, end);
+}
+
+bool MappedImage::Scan(const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start, const uint8_t *end)
+{
+	sigscan::stream_scanner scanner(patterns, [&](size_t id, uintptr_t address, const uint8_t *)
+	{
+		return callback(id, (uint8_t *)address);
+	});
+
+	return Feed(scanner, start, end);
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "imageview.h"
+#include "pe.h"
+
+// A PE file mapped read-only from disk and presented as if it were loaded at `base`.
+// Scanning the file a process was started from is much cheaper than reading the process, and works without one.
+class MappedImage : public ImageView
+{
+public:
+	MappedImage(const std::filesystem::path &path, const void *base);
+	~MappedImage();
+
+	MappedImage(const MappedImage &) = delete;
+	MappedImage &operator=(const MappedImage &) = delete;
+
+	bool IsOpen() const { return data != nullptr; }
+	const PE::Headers &GetHeaders() const { return headers; }
+
+	std::pair<const uint8_t *, const uint8_t *> GetCodeRange() const override;
+	const uint8_t *Get(const void *address, size_t size) override;
+
+	bool ScanAll(const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start, const uint8_t *end) override;
+	bool Scan(const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start, const uint8_t *end) override;
+	using ImageView::Scan;
+
+	intptr_t GetRelocationDelta() const override;
+
+private:
+	// A piece of the file that is loaded contiguously at base + rva
+	struct Extent
+	{
+		uint32_t rva;
+		uint32_t size;
+		size_t file_offset;
+		bool is_code;
+	};
+
+	void Close();
+	bool Feed(sigscan::stream_scanner &scanner, const uint8_t *start, const uint8_t *end) const;
+
+	const uint8_t *base;
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+
+	PE::Headers headers{};
+	std::vector<Extent> extents;
+};
\ No newline at end of file
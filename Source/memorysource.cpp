@@ -0,0 +1,664 @@
+#include "memorysource.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#endif
+
+#include "log.h"
+#include "pagecache.h"
+#include "regionmap.h"
+#include "threadpool.h"
+#include "trace.h"
+
+#define READ_LIMIT (1024 * 1024 * 2) // 2 MB
+
+unsigned long ProcUtil::GetLastSystemError()
+{
+#ifdef _WIN32
+	return ::GetLastError();
+#else
+	return (unsigned long)errno;
+#endif
+}
+
+ProcUtil::MemorySource::MemorySource()
+	: regions(new RegionMap(*this)), page_cache(new PageCache(*this))
+{
+}
+
+ProcUtil::MemorySource::~MemorySource() = default;
+
+bool ProcUtil::MemorySource::ReadCached(const void *address, void *buffer, size_t size)
+{
+	return page_cache->Read(address, buffer, size);
+}
+
+bool ProcUtil::MemorySource::WriteCached(const void *address, const void *buffer, size_t size)
+{
+	const bool result = Write(address, buffer, size);
+	page_cache->Invalidate(address, size);
+	return result;
+}
+
+// Requests that lie close together (e.g. pointers in the same .data page) are served by one read and split up afterwards.
+// If that read fails, its requests are retried one by one so each still gets its own result.
+size_t ProcUtil::MemorySource::ReadMany(ReadRequest *requests, size_t count)
+{
+	const size_t merge_gap = 0x1000;
+	const size_t merge_limit = 0x10000;
+
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return requests[a].address < requests[b].address; });
+
+	std::vector<uint8_t> span;
+	size_t completed = 0;
+	size_t i = 0;
+
+	while (i < count)
+	{
+		const uint8_t *start = (const uint8_t *)requests[order[i]].address;
+		const uint8_t *end = start + requests[order[i]].size;
+
+		size_t j = i + 1;
+		while (j < count)
+		{
+			const auto &next = requests[order[j]];
+			const uint8_t *next_start = (const uint8_t *)next.address;
+			const uint8_t *next_end = (std::max)(end, next_start + next.size);
+
+			if (next_start > end + merge_gap || (size_t)(next_end - start) > merge_limit)
+				break;
+
+			end = next_end;
+			j++;
+		}
+
+		bool merged = false;
+		if (j - i > 1)
+		{
+			span.resize(end - start);
+			merged = Read(start, span.data(), span.size());
+		}
+
+		for (size_t k = i; k < j; k++)
+		{
+			auto &request = requests[order[k]];
+
+			if (merged)
+			{
+				memcpy(request.buffer, span.data() + ((const uint8_t *)request.address - start), request.size);
+				request.bytes_read = request.size;
+				completed++;
+			}
+			else if (Read(request.address, request.buffer, request.size, &request.bytes_read))
+			{
+				completed++;
+			}
+		}
+
+		i = j;
+	}
+
+	return completed;
+}
+
+using ChunkCallback = std::function<bool(const uint8_t *remote, const uint8_t *local, size_t size)>;
+using ChunkReader = std::function<bool(const uint8_t *remote, size_t size, size_t &bytes_read)>; // return false to abort the walk
+
+bool ProcUtil::PipelinedReads = true;
+
+// Aligned READ_LIMIT-sized buffers that are recycled across scans instead of being allocated for every region
+class BufferArena
+{
+public:
+	static BufferArena &Get()
+	{
+		static BufferArena arena;
+		return arena;
+	}
+
+	uint8_t *Acquire()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (!free.empty())
+			{
+				uint8_t *buffer = free.back();
+				free.pop_back();
+				return buffer;
+			}
+		}
+
+		return static_cast<uint8_t *>(::operator new(READ_LIMIT, std::align_val_t(BUFFER_ALIGNMENT)));
+	}
+
+	void Release(uint8_t *buffer)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		free.push_back(buffer);
+	}
+
+	~BufferArena()
+	{
+		for (uint8_t *buffer : free)
+			::operator delete(buffer, std::align_val_t(BUFFER_ALIGNMENT));
+	}
+
+private:
+	static constexpr size_t BUFFER_ALIGNMENT = 4096;
+
+	std::mutex lock;
+	std::vector<uint8_t *> free;
+};
+
+// Walks the committed, readable regions of [start, end) in back-to-back READ_LIMIT chunks, so every byte is read once. A failed read ends the region.
+bool WalkChunks(ProcUtil::MemorySource &source, const uint8_t *start, const uint8_t *end, ProcUtil::ScanStats &stats, const ChunkReader &read)
+{
+	auto i = start;
+
+	while (i < end)
+	{
+		ProcUtil::MemoryRegion region;
+		if (!source.GetRegions().Find(i, region, &stats.syscalls))
+		{
+			return true;
+		}
+
+		size_t size = region.size - (i - region.base);
+		if (i + size >= end) size = end - i;
+
+		if (region.readable)
+		{
+			const uint8_t *base = i;
+			size_t remaining = size;
+
+			while (remaining > 0)
+			{
+				size_t bytes_read = 0;
+
+				if (!read(base, remaining < READ_LIMIT ? remaining : READ_LIMIT, bytes_read))
+					return false;
+
+				if (bytes_read == 0)
+					break;
+
+				remaining -= bytes_read;
+				base += bytes_read;
+			}
+		}
+
+		i += size;
+	}
+
+	return true;
+}
+
+bool ReadChunk(ProcUtil::MemorySource &source, const uint8_t *remote, uint8_t *buffer, size_t size, size_t &bytes_read, ProcUtil::ScanStats &stats)
+{
+	bytes_read = 0;
+
+	Trace::Span span("ReadChunk", "read", Trace::Address("address", remote), Trace::Value("size", size));
+
+	stats.syscalls++;
+	if (!source.Read(remote, buffer, size, &bytes_read))
+	{
+		bytes_read = 0;
+		return false;
+	}
+
+	stats.bytes_read += bytes_read;
+	return true;
+}
+
+// Feeds the committed, readable memory in [start, end) to `on_chunk`. With PipelinedReads, a reader thread fills the next buffers
+// while the current one is being scanned. `on_chunk` may throw: the reader is stopped and every buffer returned on the way out.
+bool ScanRange(ProcUtil::MemorySource &source, const uint8_t *start, const uint8_t *end, ProcUtil::ScanStats &stats, const ChunkCallback &on_chunk)
+{
+	auto &arena = BufferArena::Get();
+
+	if (!ProcUtil::PipelinedReads)
+	{
+		struct Lease
+		{
+			BufferArena &arena;
+			uint8_t *buffer;
+
+			~Lease()
+			{
+				arena.Release(buffer);
+			}
+		} lease{ arena, arena.Acquire() };
+
+		return WalkChunks(source, start, end, stats, [&](const uint8_t *remote, size_t size, size_t &bytes_read)
+		{
+			if (!ReadChunk(source, remote, lease.buffer, size, bytes_read, stats))
+				return true;
+
+			Trace::Span span("ScanChunk", "scan", Trace::Address("address", remote), Trace::Value("size", bytes_read));
+			return on_chunk(remote, lease.buffer, bytes_read);
+		});
+	}
+
+	struct Filled
+	{
+		const uint8_t *remote;
+		uint8_t *buffer;
+		size_t size;
+	};
+
+	// Everything shared with the reader thread. Destroying it stops and joins the reader and returns every buffer, however
+	// the scan ends.
+	struct Pipeline
+	{
+		BufferArena &arena;
+		std::mutex lock;
+		std::condition_variable changed;
+		std::vector<uint8_t *> free_buffers;
+		std::deque<Filled> ready;
+		bool finished = false;
+		bool cancelled = false;
+		std::thread reader;
+
+		explicit Pipeline(BufferArena &arena)
+			: arena(arena)
+		{
+		}
+
+		void Stop()
+		{
+			if (!reader.joinable())
+				return;
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				cancelled = true;
+			}
+
+			changed.notify_all();
+			reader.join();
+		}
+
+		~Pipeline()
+		{
+			Stop();
+
+			for (const auto &chunk : ready) arena.Release(chunk.buffer);
+			for (uint8_t *buffer : free_buffers) arena.Release(buffer);
+		}
+	} pipeline(arena);
+
+	const size_t depth = 3; // one being scanned, up to two in flight
+	for (size_t i = 0; i < depth; i++)
+		pipeline.free_buffers.push_back(arena.Acquire());
+
+	ProcUtil::ScanStats reader_stats{};
+
+	pipeline.reader = std::thread([&]()
+	{
+		Trace::SetThreadName("scan reader");
+
+		WalkChunks(source, start, end, reader_stats, [&](const uint8_t *remote, size_t size, size_t &bytes_read)
+		{
+			uint8_t *buffer;
+
+			{
+				std::unique_lock<std::mutex> guard(pipeline.lock);
+				pipeline.changed.wait(guard, [&] { return pipeline.cancelled || !pipeline.free_buffers.empty(); });
+				if (pipeline.cancelled) return false;
+
+				buffer = pipeline.free_buffers.back();
+				pipeline.free_buffers.pop_back();
+			}
+
+			const bool success = ReadChunk(source, remote, buffer, size, bytes_read, reader_stats) && bytes_read > 0;
+
+			{
+				std::lock_guard<std::mutex> guard(pipeline.lock);
+				if (success)
+					pipeline.ready.push_back({ remote, buffer, bytes_read });
+				else
+					pipeline.free_buffers.push_back(buffer);
+			}
+
+			pipeline.changed.notify_all();
+			return true;
+		});
+
+		{
+			std::lock_guard<std::mutex> guard(pipeline.lock);
+			pipeline.finished = true;
+		}
+
+		pipeline.changed.notify_all();
+	});
+
+	bool result = true;
+
+	while (true)
+	{
+		Filled chunk;
+
+		{
+			std::unique_lock<std::mutex> guard(pipeline.lock);
+			pipeline.changed.wait(guard, [&] { return pipeline.finished || !pipeline.ready.empty(); });
+			if (pipeline.ready.empty()) break;
+
+			chunk = pipeline.ready.front();
+			pipeline.ready.pop_front();
+		}
+
+		bool keep_going;
+		{
+			// handed back to the reader once scanned, also if on_chunk throws
+			struct Return
+			{
+				Pipeline &pipeline;
+				uint8_t *buffer;
+
+				~Return()
+				{
+					{
+						std::lock_guard<std::mutex> guard(pipeline.lock);
+						pipeline.free_buffers.push_back(buffer);
+					}
+
+					pipeline.changed.notify_all();
+				}
+			} handback{ pipeline, chunk.buffer };
+
+			Trace::Span span("ScanChunk", "scan", Trace::Address("address", chunk.remote), Trace::Value("size", chunk.size));
+			keep_going = on_chunk(chunk.remote, chunk.buffer, chunk.size);
+		}
+
+		if (!keep_going)
+		{
+			result = false;
+			break;
+		}
+	}
+
+	pipeline.Stop(); // reader_stats is only complete once the reader is done
+
+	stats.bytes_read += reader_stats.bytes_read;
+	stats.syscalls += reader_stats.syscalls;
+	return result;
+}
+
+void *ProcUtil::ScanProcess(MemorySource &source, const char *aob, const char *mask, const uint8_t *start, const uint8_t *end)
+{
+	void *result = nullptr;
+
+	ScanProcessAll(source, aob, mask, [&](const uint8_t *remote, const uint8_t *)
+	{
+		result = (void *)remote;
+		return false;
+	}, start, end);
+
+	return result;
+}
+
+// Reads exactly the chunks WalkChunks would and applies the same cut-off, so it reports what ScanProcess reports: a failed read
+// ends its region, and a match is only found if every chunk it touches was read. Each chunk also reads the `length` bytes that
+// follow it, so matches that start in it and continue into the next chunk are seen without a shared stream. (Like sigscan::scan,
+// the stream only reports a match that is followed by at least one more byte.)
+void *ProcUtil::ScanProcessParallel(MemorySource &source, const char *aob, const char *mask, ThreadPool &pool, const uint8_t *start, const uint8_t *end)
+{
+	Trace::Span span("ScanProcessParallel", "scan", Trace::Address("start", start), Trace::Address("end", end));
+
+	enum class ChunkState : uint8_t
+	{
+		Pending, // not read (yet): a lower match looked settled
+		Read,
+		Failed
+	};
+
+	struct Chunk
+	{
+		const uint8_t *base;
+		size_t size;
+		size_t region; // index of the region it's in, for the cut-off
+		size_t follow; // bytes after it that continue the stream (next chunks of contiguous readable memory), up to length
+		ChunkState state;
+		uintptr_t match; // lowest match starting in it, UINTPTR_MAX if none
+	};
+
+	const sigscan::pattern pattern(aob, mask);
+	std::vector<Chunk> chunks;
+
+	size_t region_index = 0;
+	auto i = start;
+
+	while (i < end)
+	{
+		MemoryRegion region;
+		if (!source.GetRegions().Find(i, region))
+		{
+			break;
+		}
+
+		size_t size = region.size - (i - region.base);
+		if (i + size >= end) size = end - i;
+
+		if (region.readable)
+		{
+			for (size_t offset = 0; offset < size; offset += READ_LIMIT)
+				chunks.push_back({ i + offset, (std::min)(size - offset, (size_t)READ_LIMIT), region_index, 0, ChunkState::Pending, UINTPTR_MAX });
+		}
+
+		region_index++;
+		i += size;
+	}
+
+	for (size_t index = 0; index < chunks.size(); index++)
+	{
+		auto &chunk = chunks[index];
+		for (size_t next = index + 1; next < chunks.size() && chunk.follow < pattern.length; next++)
+		{
+			if (chunks[next].base != chunks[next - 1].base + chunks[next - 1].size)
+				break;
+
+			chunk.follow = (std::min)(chunk.follow + chunks[next].size, pattern.length);
+		}
+	}
+
+	RFU_LOG(Info, Scan, "[ProcUtil] ScanProcessParallel(%p, %s): strategy=%s, %zu chunks, %zu threads\n", source.GetTag(), mask, sigscan::strategy_name(pattern.method), chunks.size(), pool.GetThreadCount() + 1);
+
+	// Lowest match found so far. Chunks that start past the byte after it can't change the result unless it's cut off, which
+	// is rare: those are read in another round.
+	std::atomic<uintptr_t> best{ UINTPTR_MAX };
+
+	auto read_chunk = [&](size_t index)
+	{
+		auto &chunk = chunks[index];
+		const uintptr_t lowest = best.load(std::memory_order_relaxed);
+		if ((uintptr_t)chunk.base >= lowest && (uintptr_t)chunk.base - lowest > pattern.length)
+			return; // a lower match is already settled
+
+		uint8_t *buffer = BufferArena::Get().Acquire();
+
+		size_t bytes_read = 0;
+		bool read;
+		{
+			Trace::Span span("ReadChunk", "read", Trace::Address("address", chunk.base), Trace::Value("size", chunk.size));
+			read = source.Read(chunk.base, buffer, chunk.size, &bytes_read);
+		}
+
+		chunk.state = read ? ChunkState::Read : ChunkState::Failed;
+
+		if (read)
+		{
+			const uintptr_t chunk_end = (uintptr_t)chunk.base + chunk.size;
+
+			Trace::Span span("ScanChunk", "scan", Trace::Address("address", chunk.base), Trace::Value("size", chunk.size));
+			sigscan::stream_scanner scanner(pattern, [&](size_t, uintptr_t remote, const uint8_t *)
+			{
+				if (remote < chunk_end)
+				{
+					chunk.match = remote;
+
+					uintptr_t current = best.load();
+					while (remote < current && !best.compare_exchange_weak(current, remote));
+				}
+
+				return false;
+			});
+
+			// the bytes that follow are only read to finish matches that start in this chunk; whether they count is up to the
+			// chunks they belong to (see below)
+			if (scanner.feed(buffer, chunk.size, (uintptr_t)chunk.base) && chunk.follow > 0)
+			{
+				std::vector<uint8_t> follow(chunk.follow);
+				if (source.Read((const uint8_t *)chunk_end, follow.data(), follow.size()))
+					scanner.feed(follow.data(), follow.size(), chunk_end);
+			}
+		}
+
+		BufferArena::Get().Release(buffer);
+	};
+
+	std::vector<size_t> pending(chunks.size());
+	for (size_t index = 0; index < chunks.size(); index++) pending[index] = index;
+
+	while (!pending.empty())
+	{
+		best = UINTPTR_MAX;
+		pool.ParallelFor(pending.size(), [&](size_t index)
+		{
+			read_chunk(pending[index]);
+		});
+
+		// in address order, as WalkChunks would have read them
+		size_t cut_region = SIZE_MAX;
+		bool complete = true;
+
+		for (size_t index = 0; index < chunks.size() && complete; index++)
+		{
+			const auto &chunk = chunks[index];
+			if (chunk.region == cut_region)
+				continue;
+
+			if (chunk.state == ChunkState::Pending)
+			{
+				complete = false;
+				break;
+			}
+
+			if (chunk.state == ChunkState::Failed)
+			{
+				cut_region = chunk.region;
+				continue;
+			}
+
+			if (chunk.match == UINTPTR_MAX)
+				continue;
+
+			// the chunks the match (and the byte after it) runs into have to have been read as well, as the serial stream would
+			// have broken there
+			bool whole = true;
+			for (size_t next = index + 1; next < chunks.size() && (uintptr_t)chunks[next].base <= chunk.match + pattern.length; next++)
+			{
+				if (chunks[next].state == ChunkState::Pending)
+				{
+					complete = false;
+					break;
+				}
+
+				whole = whole && chunks[next].state == ChunkState::Read;
+			}
+
+			if (complete && whole)
+				return (void *)chunk.match;
+		}
+
+		if (complete)
+			break;
+
+		pending.clear();
+		for (size_t index = 0; index < chunks.size(); index++)
+		{
+			if (chunks[index].state == ChunkState::Pending)
+				pending.push_back(index);
+		}
+	}
+
+	return nullptr;
+}
+
+bool ProcUtil::ScanProcessAll(MemorySource &source, const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start, const uint8_t *end, ScanStats *stats)
+{
+	Trace::Span span("ScanProcess", "scan", Trace::Address("start", start), Trace::Address("end", end));
+
+	const sigscan::pattern pattern(aob, mask);
+	RFU_LOG(Info, Scan, "[ProcUtil] ScanProcess(%p, %s): strategy=%s\n", source.GetTag(), mask, sigscan::strategy_name(pattern.method));
+
+	ScanStats discarded{};
+	sigscan::stream_scanner scanner(pattern, [&](size_t, uintptr_t remote, const uint8_t *local)
+	{
+		return callback((const uint8_t *)remote, local);
+	});
+
+	return ScanRange(source, start, end, stats ? *stats : discarded, [&](const uint8_t *remote, const uint8_t *local, size_t size)
+	{
+		return scanner.feed(local, size, (uintptr_t)remote);
+	});
+}
+
+bool ProcUtil::ScanProcess(MemorySource &source, const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start, const uint8_t *end, ScanStats *stats)
+{
+	Trace::Span span("ScanProcess", "scan", Trace::Address("start", start), Trace::Address("end", end));
+
+	ScanStats discarded{};
+	sigscan::stream_scanner scanner(patterns, [&](size_t id, uintptr_t remote, const uint8_t *)
+	{
+		return callback(id, (uint8_t *)remote);
+	});
+
+	return ScanRange(source, start, end, stats ? *stats : discarded, [&](const uint8_t *remote, const uint8_t *local, size_t size)
+	{
+		return scanner.feed(local, size, (uintptr_t)remote);
+	});
+}
+
+bool ProcUtil::ScanFile(const std::filesystem::path &path, const char *aob, const char *mask, const FileMatchCallback &callback)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	const sigscan::pattern pattern(aob, mask);
+	sigscan::stream_scanner scanner(pattern, [&](size_t, uintptr_t offset, const uint8_t *local)
+	{
+		return callback((size_t)offset, local);
+	});
+
+	auto &arena = BufferArena::Get();
+	uint8_t *buffer = arena.Acquire();
+	size_t offset = 0;
+
+	while (file)
+	{
+		file.read((char *)buffer, READ_LIMIT);
+		const size_t bytes_read = (size_t)file.gcount();
+
+		if (bytes_read == 0 || !scanner.feed(buffer, bytes_read, offset))
+			break;
+
+		offset += bytes_read;
+	}
+
+	arena.Release(buffer);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "sigscan.h"
+
+class ThreadPool;
+
+// Everything the scan pipeline needs from a process, behind an interface so it runs against any backend
+// (Win32 in procutil.h, process_vm_readv in linuxmemory.h)
+namespace ProcUtil
+{
+	class RegionMap;
+	class PageCache;
+
+	// Thrown by the typed reads below; `GetLastError()` is GetLastError() on Windows and errno elsewhere
+	class MemoryException : public std::runtime_error
+	{
+	public:
+		MemoryException(const char *message, unsigned long last_error)
+			: std::runtime_error(message), last_error(last_error)
+		{
+		}
+
+		unsigned long GetLastError() const
+		{
+			return last_error;
+		}
+
+	private:
+		unsigned long last_error;
+	};
+
+	unsigned long GetLastSystemError();
+
+	struct ModuleInfo
+	{
+		std::filesystem::path path;
+		void *base = nullptr;
+		size_t size = 0;
+	};
+
+	struct MemoryRegion
+	{
+		const uint8_t *base = nullptr;
+		size_t size = 0;
+		bool readable = false; // committed, readable and not a guard page
+	};
+
+	struct ReadRequest
+	{
+		const void *address = nullptr;
+		void *buffer = nullptr;
+		size_t size = 0;
+		size_t bytes_read = 0;
+	};
+
+	struct ScanStats
+	{
+		size_t bytes_read = 0;
+		size_t syscalls = 0; // reads, and region queries the RegionMap didn't have cached
+	};
+
+	class MemorySource
+	{
+	public:
+		MemorySource();
+		virtual ~MemorySource();
+
+		MemorySource(const MemorySource &) = delete;
+		MemorySource &operator=(const MemorySource &) = delete;
+
+		virtual const void *GetTag() const = 0; // identifies the process in log lines ([%p])
+		virtual bool Is64Bit() = 0;
+
+		// True only if all `size` bytes were copied; `bytes_read` receives the number of bytes copied either way
+		virtual bool Read(const void *address, void *buffer, size_t size, size_t *bytes_read = nullptr) = 0;
+		virtual bool Write(const void *address, const void *buffer, size_t size) = 0;
+
+		// Reads every request, filling in its bytes_read (missing pages leave it short). Returns how many were read completely.
+		// Backends issue one vectored call where the OS has one; the default merges nearby requests into shared reads.
+		virtual size_t ReadMany(ReadRequest *requests, size_t count);
+
+		// The region containing `address` (mapped or not); false past the end of the address space
+		virtual bool QueryRegion(const void *address, MemoryRegion &out) = 0;
+
+		// Backends that keep their own copy of the layout drop it here; called when the RegionMap is invalidated
+		virtual void FlushLayoutCache() {}
+
+		virtual std::vector<ModuleInfo> GetModules() = 0;
+		virtual bool GetMainModule(ModuleInfo &out) = 0;
+
+		// Cached layout of the address space; the scans below walk regions through it instead of calling QueryRegion
+		RegionMap &GetRegions() { return *regions; }
+
+		// Page cache used by the typed reads below (disabled until someone enables it)
+		PageCache &GetPageCache() { return *page_cache; }
+
+		bool ReadCached(const void *address, void *buffer, size_t size); // through the page cache
+		bool WriteCached(const void *address, const void *buffer, size_t size); // Write, then drops the affected pages from the cache
+
+		// Every read system call made so far, for timing instrumentation (see PhaseStats)
+		ScanStats GetIoStats() const
+		{
+			return { io_bytes.load(std::memory_order_relaxed), io_syscalls.load(std::memory_order_relaxed) };
+		}
+
+	protected:
+		// Backends call this once per read system call
+		void CountRead(size_t bytes)
+		{
+			io_bytes.fetch_add(bytes, std::memory_order_relaxed);
+			io_syscalls.fetch_add(1, std::memory_order_relaxed);
+		}
+
+	private:
+		std::unique_ptr<RegionMap> regions;
+		std::unique_ptr<PageCache> page_cache;
+		std::atomic<size_t> io_bytes{ 0 };
+		std::atomic<size_t> io_syscalls{ 0 }; // atomic: pipelined scans read from a second thread
+	};
+
+	// `local` points at a local copy of the matched bytes and is only valid for the duration of the call. Return false to stop scanning.
+	using MatchCallback = std::function<bool(const uint8_t *remote, const uint8_t *local)>;
+	using FileMatchCallback = std::function<bool(size_t offset, const uint8_t *local)>;
+
+	extern bool PipelinedReads; // read the next chunk on a separate thread while the current one is scanned (default on)
+
+	void *ScanProcess(MemorySource &source, const char *aob, const char *mask, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX);
+	void *ScanProcessParallel(MemorySource &source, const char *aob, const char *mask, ThreadPool &pool, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX); // returns the lowest match, same as ScanProcess
+	bool ScanProcessAll(MemorySource &source, const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX, ScanStats *stats = nullptr);
+	bool ScanProcess(MemorySource &source, const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX, ScanStats *stats = nullptr);
+	bool ScanFile(const std::filesystem::path &path, const char *aob, const char *mask, const FileMatchCallback &callback); // false if the file couldn't be opened
+
+	template <typename T>
+	inline T Read(MemorySource &source, const void *location)
+	{
+		T value;
+		if (!source.ReadCached(location, &value, sizeof(T))) throw MemoryException("unable to read process memory", GetLastSystemError());
+		return value;
+	}
+
+	inline const void *ReadPointer(MemorySource &source, const void *location)
+	{
+		return source.Is64Bit() ? (const void *)Read<uint64_t>(source, location) : (const void *)(uintptr_t)Read<uint32_t>(source, location);
+	}
+
+	template <typename T>
+	inline void Write(MemorySource &source, const void *location, const T &value)
+	{
+		if (!source.WriteCached(location, &value, sizeof(T))) throw MemoryException("unable to write process memory", GetLastSystemError());
+	}
+}
\ No newline at end of file
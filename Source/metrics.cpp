@@ -0,0 +1,364 @@
+#include "metrics.h"
+#include "phasestats.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+const char *const Metrics::DefaultEndpoint = "\\\\.\\pipe\\rbxfpsunlocker-metrics";
+#else
+const char *const Metrics::DefaultEndpoint = "/tmp/rbxfpsunlocker-metrics.sock";
+#endif
+
+namespace
+{
+	struct VariantCounters
+	{
+		const char *name;
+		std::atomic<uint64_t> successes{ 0 };
+		std::atomic<uint64_t> failures{ 0 };
+	};
+
+	// anything not listed is counted under "other"
+	VariantCounters Variants[] = {
+		{ "studio" }, { "byfron" }, { "ltcg" }, { "non-ltcg" }, { "uwp" }, { "cached" }, { "shared" }, { "flags-file" }, { "none" }, { "other" }
+	};
+
+	const char *const RetryNames[] = { "module", "scan", "resolve" };
+	static_assert(sizeof(RetryNames) / sizeof(RetryNames[0]) == (size_t)Metrics::Retry::Count, "missing retry name");
+
+	std::atomic<uint64_t> AttachedProcesses{ 0 };
+	std::atomic<uint64_t> Retries[(size_t)Metrics::Retry::Count]{};
+	std::atomic<uint64_t> FlagsFileWrites{ 0 };
+	std::atomic<uint64_t> FlagsFileFailures{ 0 };
+
+	VariantCounters &GetVariant(const char *name)
+	{
+		const size_t count = sizeof(Variants) / sizeof(Variants[0]);
+
+		for (size_t i = 0; i + 1 < count; i++)
+		{
+			if (name && strcmp(Variants[i].name, name) == 0)
+				return Variants[i];
+		}
+
+		return Variants[count - 1];
+	}
+
+	void AppendLine(std::string &out, const char *format, ...)
+	{
+		char buffer[256];
+
+		va_list args;
+		va_start(args, format);
+		const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+
+		if (length > 0)
+			out.append(buffer, (size_t)length < sizeof(buffer) ? (size_t)length : sizeof(buffer) - 1);
+	}
+
+	void AppendHeader(std::string &out, const char *name, const char *type, const char *help)
+	{
+		AppendLine(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+	}
+
+	std::mutex lock; // guards the server state below
+	std::thread server;
+	std::string endpoint_name;
+
+#ifdef _WIN32
+	HANDLE stop_event = NULL; // set by Stop; every wait of the server thread also waits on it
+
+	HANDLE CreatePipe(bool first)
+	{
+		return CreateNamedPipeA(endpoint_name.c_str(), PIPE_ACCESS_OUTBOUND | FILE_FLAG_OVERLAPPED | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+			PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, PIPE_UNLIMITED_INSTANCES, 64 * 1024, 0, 0, NULL);
+	}
+
+	// Waits for the overlapped operation started on `pipe`. Cancels it and returns false on a timeout or once Stop was called
+	bool Complete(HANDLE pipe, OVERLAPPED &overlapped, DWORD timeout, DWORD &transferred)
+	{
+		const HANDLE handles[] = { overlapped.hEvent, stop_event };
+		if (WaitForMultipleObjects(2, handles, FALSE, timeout) == WAIT_OBJECT_0)
+			return GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) != FALSE;
+
+		CancelIo(pipe);
+		GetOverlappedResult(pipe, &overlapped, &transferred, TRUE); // `overlapped` is in use until the cancellation went through
+		return false;
+	}
+
+	bool Connect(HANDLE pipe, OVERLAPPED &overlapped)
+	{
+		ResetEvent(overlapped.hEvent);
+		if (ConnectNamedPipe(pipe, &overlapped))
+			return true;
+
+		DWORD transferred = 0;
+		switch (GetLastError())
+		{
+		case ERROR_PIPE_CONNECTED: return true; // connected between CreateNamedPipe and ConnectNamedPipe
+		case ERROR_IO_PENDING: return Complete(pipe, overlapped, INFINITE, transferred);
+		default: return false;
+		}
+	}
+
+	void Send(HANDLE pipe, OVERLAPPED &overlapped, const std::string &text)
+	{
+		for (size_t offset = 0; offset < text.size();)
+		{
+			ResetEvent(overlapped.hEvent);
+			if (!WriteFile(pipe, text.data() + offset, (DWORD)(text.size() - offset), NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+				return;
+
+			// a client that stops reading can't hold up the next one (or Stop) for long
+			DWORD written = 0;
+			if (!Complete(pipe, overlapped, 1000, written) || written == 0)
+				return;
+
+			offset += written;
+		}
+	}
+
+	void ServerMain(HANDLE pipe)
+	{
+		OVERLAPPED overlapped{};
+		overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+		while (pipe != INVALID_HANDLE_VALUE)
+		{
+			if (overlapped.hEvent && Connect(pipe, overlapped))
+			{
+				std::string text;
+				Metrics::Render(text);
+				Send(pipe, overlapped, text);
+			}
+
+			// closed without DisconnectNamedPipe, which would throw away whatever the client hasn't read yet
+			CloseHandle(pipe);
+
+			const bool stopping = !overlapped.hEvent || WaitForSingleObject(stop_event, 0) == WAIT_OBJECT_0;
+			pipe = stopping ? INVALID_HANDLE_VALUE : CreatePipe(false);
+		}
+
+		if (overlapped.hEvent)
+			CloseHandle(overlapped.hEvent);
+	}
+#else
+	int listener = -1;
+
+	void ServerMain()
+	{
+		while (true)
+		{
+			const int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+			if (client < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+
+				break; // shut down by Stop
+			}
+
+			// a client that stops reading can't hold up the next one for long
+			timeval timeout{ 1, 0 };
+			setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+			std::string text;
+			Metrics::Render(text);
+
+			for (size_t offset = 0; offset < text.size();)
+			{
+				const ssize_t sent = send(client, text.data() + offset, text.size() - offset, MSG_NOSIGNAL);
+				if (sent <= 0)
+					break;
+
+				offset += (size_t)sent;
+			}
+
+			close(client);
+		}
+	}
+#endif
+}
+
+void Metrics::SetAttachedProcesses(size_t count)
+{
+	AttachedProcesses.store(count, std::memory_order_relaxed);
+}
+
+void Metrics::RecordAttach(const char *variant, bool success)
+{
+	auto &counters = GetVariant(variant);
+	(success ? counters.successes : counters.failures).fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::RecordRetry(Retry step)
+{
+	Retries[(size_t)step].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::RecordFlagsFileWrite(bool success)
+{
+	(success ? FlagsFileWrites : FlagsFileFailures).fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::Render(std::string &out)
+{
+	AppendHeader(out, "rfu_attached_processes", "gauge", "Roblox processes currently attached to.");
+	AppendLine(out, "rfu_attached_processes %llu\n", (unsigned long long)AttachedProcesses.load(std::memory_order_relaxed));
+
+	AppendHeader(out, "rfu_attaches_total", "counter", "Finished attaches by how the TaskScheduler offsets were found.");
+	for (const auto &variant : Variants)
+	{
+		AppendLine(out, "rfu_attaches_total{variant=\"%s\",result=\"success\"} %llu\n", variant.name, (unsigned long long)variant.successes.load(std::memory_order_relaxed));
+		AppendLine(out, "rfu_attaches_total{variant=\"%s\",result=\"failure\"} %llu\n", variant.name, (unsigned long long)variant.failures.load(std::memory_order_relaxed));
+	}
+
+	AppendHeader(out, "rfu_attach_retries_total", "counter", "Attach steps retried after a backoff.");
+	for (size_t i = 0; i < (size_t)Retry::Count; i++)
+		AppendLine(out, "rfu_attach_retries_total{step=\"%s\"} %llu\n", RetryNames[i], (unsigned long long)Retries[i].load(std::memory_order_relaxed));
+
+	AppendHeader(out, "rfu_flags_file_writes_total", "counter", "ClientAppSettings.json writes.");
+	AppendLine(out, "rfu_flags_file_writes_total{result=\"success\"} %llu\n", (unsigned long long)FlagsFileWrites.load(std::memory_order_relaxed));
+	AppendLine(out, "rfu_flags_file_writes_total{result=\"failure\"} %llu\n", (unsigned long long)FlagsFileFailures.load(std::memory_order_relaxed));
+
+	PhaseStats::Summary summaries[(size_t)PhaseStats::Phase::Count];
+	for (size_t i = 0; i < (size_t)PhaseStats::Phase::Count; i++)
+		summaries[i] = PhaseStats::GetSummary((PhaseStats::Phase)i);
+
+	// TimeToUnlock is the one to alert on; the other phases break it down
+	AppendHeader(out, "rfu_phase_duration_seconds", "summary", "Duration of each attach phase.");
+	for (size_t i = 0; i < (size_t)PhaseStats::Phase::Count; i++)
+	{
+		const auto &summary = summaries[i];
+		const char *name = PhaseStats::GetName((PhaseStats::Phase)i);
+
+		AppendLine(out, "rfu_phase_duration_seconds{phase=\"%s\",quantile=\"0.5\"} %.6f\n", name, summary.p50_us / 1e6);
+		AppendLine(out, "rfu_phase_duration_seconds{phase=\"%s\",quantile=\"0.9\"} %.6f\n", name, summary.p90_us / 1e6);
+		AppendLine(out, "rfu_phase_duration_seconds{phase=\"%s\",quantile=\"0.99\"} %.6f\n", name, summary.p99_us / 1e6);
+		AppendLine(out, "rfu_phase_duration_seconds_sum{phase=\"%s\"} %.6f\n", name, summary.total_us / 1e6);
+		AppendLine(out, "rfu_phase_duration_seconds_count{phase=\"%s\"} %llu\n", name, (unsigned long long)summary.count);
+	}
+
+	AppendHeader(out, "rfu_phase_read_bytes_total", "counter", "Bytes read from Roblox processes during each attach phase.");
+	for (size_t i = 0; i < (size_t)PhaseStats::Phase::Count; i++)
+		AppendLine(out, "rfu_phase_read_bytes_total{phase=\"%s\"} %llu\n", PhaseStats::GetName((PhaseStats::Phase)i), (unsigned long long)summaries[i].bytes_read);
+
+	AppendHeader(out, "rfu_phase_read_bytes_per_second", "gauge", "Read throughput of each attach phase while it ran.");
+	for (size_t i = 0; i < (size_t)PhaseStats::Phase::Count; i++)
+	{
+		const auto &summary = summaries[i];
+		const double seconds = summary.total_us / 1e6;
+		AppendLine(out, "rfu_phase_read_bytes_per_second{phase=\"%s\"} %.0f\n", PhaseStats::GetName((PhaseStats::Phase)i), seconds > 0.0 ? summary.bytes_read / seconds : 0.0);
+	}
+}
+
+#ifdef _WIN32
+
+bool Metrics::Start(const char *endpoint)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (server.joinable())
+		return false;
+
+	endpoint_name = endpoint;
+
+	stop_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!stop_event)
+		return false;
+
+	// FILE_FLAG_FIRST_PIPE_INSTANCE: fails if another instance serves this endpoint already
+	HANDLE pipe = CreatePipe(true);
+	if (pipe == INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(stop_event);
+		stop_event = NULL;
+		return false;
+	}
+
+	server = std::thread(ServerMain, pipe);
+	return true;
+}
+
+void Metrics::Stop()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (!server.joinable())
+		return;
+
+	SetEvent(stop_event); // cancels the pending connect or write
+	server.join();
+
+	CloseHandle(stop_event);
+	stop_event = NULL;
+}
+
+#else
+
+bool Metrics::Start(const char *endpoint)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (server.joinable())
+		return false;
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (strlen(endpoint) >= sizeof(address.sun_path))
+		return false;
+
+	strcpy(address.sun_path, endpoint);
+
+	// a socket nobody accepts on was left behind by a run that didn't exit cleanly; one that does belongs to another instance
+	const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	const bool in_use = probe >= 0 && connect(probe, (const sockaddr *)&address, sizeof(address)) == 0;
+	if (probe >= 0) close(probe);
+	if (in_use)
+		return false;
+
+	unlink(endpoint);
+
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener < 0)
+		return false;
+
+	if (bind(listener, (const sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 8) != 0)
+	{
+		close(listener);
+		listener = -1;
+		return false;
+	}
+
+	endpoint_name = endpoint;
+	server = std::thread(ServerMain);
+	return true;
+}
+
+void Metrics::Stop()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (!server.joinable())
+		return;
+
+	shutdown(listener, SHUT_RDWR); // fails the blocked accept
+	server.join();
+
+	close(listener);
+	listener = -1;
+	unlink(endpoint_name.c_str());
+}
+
+#endif
\ No newline at end of file
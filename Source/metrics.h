@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Process-wide counters for fleet monitoring, served in the Prometheus text format on a local endpoint (a named pipe on
+// Windows, a Unix socket on Linux) so nothing listens on the network. Every connection gets one snapshot and is closed:
+//
+//   Windows: type \\.\pipe\rbxfpsunlocker-metrics
+//   Linux:   socat - UNIX-CONNECT:<path>   or   curl --http0.9 --unix-socket <path> http://localhost/metrics
+//
+// Attach latency percentiles and read volumes come from PhaseStats; recording here is a relaxed atomic add.
+namespace Metrics
+{
+	enum class Retry
+	{
+		Module, // main module not mapped yet
+		Scan, // no TaskScheduler candidates
+		Resolve, // no frame delay behind the candidates
+		Count
+	};
+
+	extern const char *const DefaultEndpoint;
+
+	void SetAttachedProcesses(size_t count);
+
+	// `variant` is how the offsets were found: a signature name ("studio", "byfron", "ltcg", ...), "cached" or "shared"
+	// offsets, "flags-file" when no offsets were needed, or "none"
+	void RecordAttach(const char *variant, bool success);
+	void RecordRetry(Retry step);
+	void RecordFlagsFileWrite(bool success);
+
+	// Appends the Prometheus exposition of everything recorded so far
+	void Render(std::string &out);
+
+	// Serves Render at `endpoint` from a thread of its own. False if the endpoint can't be created (or already serving)
+	bool Start(const char *endpoint = DefaultEndpoint);
+	void Stop();
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free queue for any number of producers and a single consumer (Vyukov's intrusive MPSC queue).
+// Push is one atomic exchange, so a producer never waits on the consumer or on another producer.
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue()
+		: head(&stub), tail(&stub)
+	{
+	}
+
+	~MpscQueue()
+	{
+		T value;
+		while (Pop(value));
+	}
+
+	MpscQueue(const MpscQueue &) = delete;
+	MpscQueue &operator=(const MpscQueue &) = delete;
+
+	// Any thread
+	void Push(T value)
+	{
+		Link(new Node(std::move(value)));
+	}
+
+	// Consumer thread only. Returns false when empty, or when the only item left is still being linked by its producer
+	// (it shows up on a later call, so producers should signal the consumer after pushing).
+	bool Pop(T &out)
+	{
+		Node *first = tail;
+		Node *next = first->next.load(std::memory_order_acquire);
+
+		if (first == &stub)
+		{
+			if (!next)
+				return false;
+
+			tail = first = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+
+		if (!next)
+		{
+			if (first != head.load(std::memory_order_acquire))
+				return false; // a push is in progress
+
+			// `first` is the last node; put the stub behind it so it can be taken without emptying the list
+			Link(&stub);
+			next = first->next.load(std::memory_order_acquire);
+			if (!next)
+				return false;
+		}
+
+		tail = next;
+		out = std::move(first->value);
+		delete first;
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		Node() = default;
+		explicit Node(T value) : value(std::move(value)) {}
+
+		std::atomic<Node *> next{ nullptr };
+		T value;
+	};
+
+	void Link(Node *node)
+	{
+		node->next.store(nullptr, std::memory_order_relaxed);
+		Node *previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	std::atomic<Node *> head; // producers link new nodes here
+	Node *tail; // consumer side
+	Node stub;
+};
\ No newline at end of file
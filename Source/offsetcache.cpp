@@ -0,0 +1,244 @@
+#include "offsetcache.h"
+#include "nlohmann.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char *CacheFilePath = "offsets.json";
+	const size_t MaxEntries = 32; // least recently used builds are dropped past this
+
+	class Hasher
+	{
+		uint64_t value = 0xCBF29CE484222325; // FNV-1a
+
+	public:
+		template <typename T>
+		void Add(const T &data)
+		{
+			Add(&data, sizeof(data));
+		}
+
+		void Add(const void *data, size_t size)
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				value ^= ((const uint8_t *)data)[i];
+				value *= 0x100000001B3;
+			}
+		}
+
+		uint64_t Get() const
+		{
+			return value;
+		}
+	};
+
+	// Serializes writers across unlocker instances; readers don't need it since the file is replaced atomically
+	class CacheLock
+	{
+#ifdef _WIN32
+		HANDLE mutex;
+#else
+		int fd;
+#endif
+
+	public:
+		CacheLock()
+		{
+#ifdef _WIN32
+			mutex = CreateMutexA(NULL, FALSE, "RFUOffsetCacheMutex");
+			if (mutex && WaitForSingleObject(mutex, 5000) == WAIT_TIMEOUT)
+			{
+				CloseHandle(mutex);
+				mutex = NULL;
+			}
+#else
+			fd = open("offsets.json.lock", O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+			if (fd >= 0 && flock(fd, LOCK_EX) != 0)
+			{
+				close(fd);
+				fd = -1;
+			}
+#endif
+		}
+
+		~CacheLock()
+		{
+#ifdef _WIN32
+			if (mutex)
+			{
+				ReleaseMutex(mutex);
+				CloseHandle(mutex);
+			}
+#else
+			if (fd >= 0)
+			{
+				flock(fd, LOCK_UN);
+				close(fd);
+			}
+#endif
+		}
+
+		bool IsHeld() const
+		{
+#ifdef _WIN32
+			return mutex != NULL;
+#else
+			return fd >= 0;
+#endif
+		}
+	};
+
+	// Replaces `to` with `from` in one step, so readers see either the old file or the new one
+	bool ReplaceFile(const char *from, const char *to)
+	{
+#ifdef _WIN32
+		if (MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+			return true;
+#else
+		if (rename(from, to) == 0)
+			return true;
+#endif
+
+		remove(from);
+		return false;
+	}
+
+	unsigned long GetProcessIdentifier()
+	{
+#ifdef _WIN32
+		return GetCurrentProcessId();
+#else
+		return (unsigned long)getpid();
+#endif
+	}
+
+	nlohmann::json LoadCacheFile()
+	{
+		std::ifstream file(CacheFilePath);
+		if (file.is_open())
+		{
+			nlohmann::json object = nlohmann::json::parse(file, nullptr, false);
+			if (!object.is_discarded() && object.is_object())
+				return object;
+		}
+
+		return nlohmann::json::object();
+	}
+
+	int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+}
+
+std::string OffsetCache::Fingerprint::ToString() const
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%08X-%08X-%016llX", timestamp, size_of_image, (unsigned long long)header_hash);
+	return buffer;
+}
+
+OffsetCache::Fingerprint OffsetCache::ComputeFingerprint(const PE::Headers &headers)
+{
+	// ImageBase is left out since the loader may rewrite it in the mapped headers
+	Hasher hasher;
+	hasher.Add(headers.machine);
+	hasher.Add(headers.timestamp);
+	hasher.Add(headers.is_64bit);
+	hasher.Add(headers.size_of_image);
+
+	for (const auto &section : headers.sections)
+	{
+		hasher.Add(section.name.data(), section.name.size());
+		hasher.Add(section.virtual_address);
+		hasher.Add(section.virtual_size);
+		hasher.Add(section.raw_size);
+		hasher.Add(section.characteristics);
+	}
+
+	Fingerprint fingerprint;
+	fingerprint.timestamp = headers.timestamp;
+	fingerprint.size_of_image = headers.size_of_image;
+	fingerprint.header_hash = hasher.Get();
+	return fingerprint;
+}
+
+bool OffsetCache::Lookup(const Fingerprint &fingerprint, Entry &out)
+{
+	try
+	{
+		const nlohmann::json cache = LoadCacheFile();
+
+		auto it = cache.find(fingerprint.ToString());
+		if (it == cache.end() || !it->is_object())
+			return false;
+
+		Entry entry{};
+		entry.ts_ptr_rvas = it->at("ts_ptr_rvas").get<std::vector<uint32_t>>();
+		entry.frame_delay_offset = it->at("frame_delay_offset").get<uint32_t>();
+
+		if (entry.ts_ptr_rvas.empty())
+			return false;
+
+		out = std::move(entry);
+		return true;
+	}
+	catch (nlohmann::json::exception &)
+	{
+		return false; // malformed entry, treat as a miss
+	}
+}
+
+bool OffsetCache::Store(const Fingerprint &fingerprint, const Entry &entry)
+{
+	CacheLock lock;
+	if (!lock.IsHeld())
+		return false;
+
+	nlohmann::json cache = LoadCacheFile();
+
+	cache[fingerprint.ToString()] = {
+		{ "ts_ptr_rvas", entry.ts_ptr_rvas },
+		{ "frame_delay_offset", entry.frame_delay_offset },
+		{ "last_used", Now() },
+	};
+
+	while (cache.size() > MaxEntries)
+	{
+		auto oldest = cache.begin();
+		for (auto it = cache.begin(); it != cache.end(); ++it)
+		{
+			if (it->value("last_used", (int64_t)0) < oldest->value("last_used", (int64_t)0))
+				oldest = it;
+		}
+		cache.erase(oldest);
+	}
+
+	// write next to the cache and swap it in so readers never see a partial file
+	char temp_path[260];
+	snprintf(temp_path, sizeof(temp_path), "%s.%lu.tmp", CacheFilePath, GetProcessIdentifier());
+
+	{
+		std::ofstream file(temp_path, std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file << cache.dump(4);
+		if (!file.good())
+			return false;
+	}
+
+	return ReplaceFile(temp_path, CacheFilePath);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pe.h"
+
+// On-disk cache of resolved offsets so attaching to a client build we've already seen skips the signature scan
+namespace OffsetCache
+{
+	// Identifies a client build without reading more than its headers
+	struct Fingerprint
+	{
+		uint32_t timestamp = 0;
+		uint32_t size_of_image = 0;
+		uint64_t header_hash = 0;
+
+		std::string ToString() const;
+	};
+
+	struct Entry
+	{
+		std::vector<uint32_t> ts_ptr_rvas; // TaskScheduler pointer candidates, the one that resolved last time first
+		uint32_t frame_delay_offset = 0;
+	};
+
+	Fingerprint ComputeFingerprint(const PE::Headers &headers);
+
+	bool Lookup(const Fingerprint &fingerprint, Entry &out);
+	bool Store(const Fingerprint &fingerprint, const Entry &entry);
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "pagecache.h"
+
+#include <cstring>
+
+ProcUtil::PageCache::PageCache(MemorySource &source, size_t capacity)
+	: source(source), capacity(capacity ? capacity : 1)
+{
+}
+
+void ProcUtil::PageCache::SetEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	this->enabled = enabled;
+	if (!enabled)
+	{
+		pages.clear();
+		index.clear();
+	}
+}
+
+bool ProcUtil::PageCache::IsEnabled()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return enabled;
+}
+
+// Returns the local copy of the page at `address` (page aligned), reading it if it's missing or from an older generation
+const uint8_t *ProcUtil::PageCache::Fetch(uintptr_t address)
+{
+	auto found = index.find(address);
+	if (found != index.end())
+	{
+		auto entry = found->second;
+		pages.splice(pages.begin(), pages, entry);
+
+		if (entry->generation == generation)
+		{
+			stats.hits++;
+			return entry->data.get();
+		}
+
+		stats.misses++;
+		if (source.Read((const void *)address, entry->data.get(), PageSize))
+		{
+			entry->generation = generation;
+			return entry->data.get();
+		}
+
+		index.erase(found);
+		pages.erase(entry);
+		return nullptr;
+	}
+
+	stats.misses++;
+
+	Page page{ address, generation, nullptr };
+	if (pages.size() >= capacity)
+	{
+		// reuse the buffer of the least recently used page
+		page.data = std::move(pages.back().data);
+		index.erase(pages.back().address);
+		pages.pop_back();
+		stats.evictions++;
+	}
+	else
+	{
+		page.data.reset(new uint8_t[PageSize]);
+	}
+
+	if (!source.Read((const void *)address, page.data.get(), PageSize))
+		return nullptr; // not cached: unreadable now doesn't mean unreadable later
+
+	pages.push_front(std::move(page));
+	index[address] = pages.begin();
+	return pages.front().data.get();
+}
+
+bool ProcUtil::PageCache::Read(const void *address, void *buffer, size_t size)
+{
+	const uintptr_t start = (uintptr_t)address;
+	const uintptr_t end = start + size;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		// only small reads benefit; anything larger than a page (or wrapping around) is read directly
+		if (enabled && size > 0 && end > start && size <= PageSize)
+		{
+			bool complete = true;
+
+			for (uintptr_t page = start & ~(uintptr_t)(PageSize - 1); page < end && complete; page += PageSize)
+			{
+				const uint8_t *data = Fetch(page);
+				if (!data)
+				{
+					complete = false;
+					break;
+				}
+
+				const uintptr_t from = page > start ? page : start;
+				const uintptr_t to = page + PageSize < end ? page + PageSize : end;
+				memcpy((uint8_t *)buffer + (from - start), data + (from - page), to - from);
+			}
+
+			if (complete)
+				return true;
+		}
+	}
+
+	// partly unreadable (or cache disabled): the source reports exactly what it could read
+	return source.Read(address, buffer, size);
+}
+
+void ProcUtil::PageCache::Invalidate()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	generation++;
+}
+
+void ProcUtil::PageCache::Invalidate(const void *address, size_t size)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	const uintptr_t start = (uintptr_t)address & ~(uintptr_t)(PageSize - 1);
+	const uintptr_t end = (uintptr_t)address + size < (uintptr_t)address ? UINTPTR_MAX : (uintptr_t)address + size;
+
+	for (auto entry = pages.begin(); entry != pages.end();)
+	{
+		if (entry->address >= start && entry->address < end)
+		{
+			index.erase(entry->address);
+			entry = pages.erase(entry);
+		}
+		else
+		{
+			++entry;
+		}
+	}
+}
+
+ProcUtil::PageCache::Stats ProcUtil::PageCache::GetStats()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return stats;
+}
+
+void ProcUtil::PageCache::ResetStats()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	stats = {};
+}
\ No newline at end of file
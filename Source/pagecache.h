@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "memorysource.h"
+
+namespace ProcUtil
+{
+	// Read-through cache of whole remote pages for the small typed reads (ProcUtil::Read, ReadPointer). Off by default.
+	// Pages are tagged with the generation they were read in, so Invalidate() drops everything at once; when full, the least
+	// recently used page is evicted.
+	class PageCache
+	{
+	public:
+		static const size_t PageSize = 0x1000;
+
+		struct Stats
+		{
+			size_t hits = 0;
+			size_t misses = 0;
+			size_t evictions = 0;
+		};
+
+		explicit PageCache(MemorySource &source, size_t capacity = 256);
+
+		PageCache(const PageCache &) = delete;
+		PageCache &operator=(const PageCache &) = delete;
+
+		// Disabling also frees every cached page
+		void SetEnabled(bool enabled);
+		bool IsEnabled();
+
+		// Same contract as MemorySource::Read; reads that can't be served from whole pages go to the source directly
+		bool Read(const void *address, void *buffer, size_t size);
+
+		void Invalidate();
+		void Invalidate(const void *address, size_t size);
+
+		Stats GetStats();
+		void ResetStats();
+
+	private:
+		struct Page
+		{
+			uintptr_t address;
+			uint64_t generation;
+			std::unique_ptr<uint8_t[]> data;
+		};
+
+		const uint8_t *Fetch(uintptr_t address);
+
+		MemorySource &source;
+		const size_t capacity;
+
+		std::mutex lock;
+		bool enabled = false;
+		uint64_t generation = 0;
+
+		std::list<Page> pages; // most recently used first
+		std::unordered_map<uintptr_t, std::list<Page>::iterator> index;
+
+		Stats stats{};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "pe.h"
+
+#include <cstring>
+
+namespace
+{
+	template <typename T>
+	bool Get(const uint8_t *data, size_t size, size_t offset, T &out)
+	{
+		if (offset > size || size - offset < sizeof(T))
+			return false;
+
+		memcpy(&out, data + offset, sizeof(T));
+		return true;
+	}
+}
+
+bool PE::ParseHeaders(const uint8_t *data, size_t size, Headers &out)
+{
+	uint16_t dos_magic;
+	uint32_t nt_offset;
+	if (!Get(data, size, 0, dos_magic) || dos_magic != 0x5A4D) // MZ
+		return false;
+	if (!Get(data, size, 0x3C, nt_offset)) // e_lfanew
+		return false;
+
+	uint32_t signature;
+	if (!Get(data, size, nt_offset, signature) || signature != 0x00004550) // PE\0\0
+		return false;
+
+	// IMAGE_FILE_HEADER
+	const size_t file_header = nt_offset + 4;
+	uint16_t section_count, optional_size;
+	if (!Get(data, size, file_header + 0, out.machine)
+		|| !Get(data, size, file_header + 2, section_count)
+		|| !Get(data, size, file_header + 4, out.timestamp)
+		|| !Get(data, size, file_header + 16, optional_size))
+		return false;
+
+	// IMAGE_OPTIONAL_HEADER32/64
+	const size_t optional_header = file_header + 20;
+	uint16_t optional_magic;
+	if (!Get(data, size, optional_header, optional_magic))
+		return false;
+
+	out.is_64bit = optional_magic == 0x20B;
+	if (!out.is_64bit && optional_magic != 0x10B)
+		return false;
+
+	if (out.is_64bit)
+	{
+		if (!Get(data, size, optional_header + 24, out.image_base))
+			return false;
+	}
+	else
+	{
+		uint32_t image_base;
+		if (!Get(data, size, optional_header + 28, image_base))
+			return false;
+		out.image_base = image_base;
+	}
+
+	if (!Get(data, size, optional_header + 56, out.size_of_image) || !Get(data, size, optional_header + 60, out.size_of_headers))
+		return false;
+
+	// IMAGE_SECTION_HEADER[]
+	out.sections.clear();
+	const size_t section_table = optional_header + optional_size;
+
+	for (uint16_t i = 0; i < section_count; i++)
+	{
+		const size_t entry = section_table + i * 40;
+
+		char name[9]{};
+		Section section{};
+		if (entry > size || size - entry < 40)
+			return false;
+
+		memcpy(name, data + entry, 8);
+		section.name = name;
+		Get(data, size, entry + 8, section.virtual_size);
+		Get(data, size, entry + 12, section.virtual_address);
+		Get(data, size, entry + 16, section.raw_size);
+		Get(data, size, entry + 20, section.raw_offset);
+		Get(data, size, entry + 36, section.characteristics);
+		out.sections.push_back(std::move(section));
+	}
+
+	return true;
+}
+
+const PE::Section *PE::Headers::FindSectionByRva(uint32_t rva) const
+{
+	for (const auto &section : sections)
+	{
+		const uint32_t extent = section.virtual_size ? section.virtual_size : section.raw_size;
+		if (rva >= section.virtual_address && rva - section.virtual_address < extent)
+			return &section;
+	}
+
+	return nullptr;
+}
+
+bool PE::Headers::RvaToFileOffset(uint32_t rva, size_t &offset) const
+{
+	if (rva < size_of_headers)
+	{
+		offset = rva;
+		return true;
+	}
+
+	const Section *section = FindSectionByRva(rva);
+	if (!section || rva - section->virtual_address >= section->raw_size)
+		return false; // not backed by the file (e.g. .bss)
+
+	offset = section->raw_offset + (rva - section->virtual_address);
+	return true;
+}
\ No newline at end of file
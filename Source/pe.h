@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal PE header parsing that doesn't depend on Windows.h, so it works the same on a remote image, a file on disk or on Linux
+namespace PE
+{
+	struct Section
+	{
+		std::string name;
+		uint32_t virtual_address = 0;
+		uint32_t virtual_size = 0;
+		uint32_t raw_offset = 0;
+		uint32_t raw_size = 0;
+		uint32_t characteristics = 0;
+
+		bool IsCode() const
+		{
+			return (characteristics & 0x20) != 0 || (characteristics & 0x20000000) != 0; // IMAGE_SCN_CNT_CODE, IMAGE_SCN_MEM_EXECUTE
+		}
+	};
+
+	struct Headers
+	{
+		uint16_t machine = 0;
+		uint32_t timestamp = 0;
+		bool is_64bit = false;
+		uint64_t image_base = 0; // preferred base
+		uint32_t size_of_image = 0;
+		uint32_t size_of_headers = 0;
+		std::vector<Section> sections;
+
+		const Section *FindSectionByRva(uint32_t rva) const;
+		bool RvaToFileOffset(uint32_t rva, size_t &offset) const;
+	};
+
+	const size_t HeaderReadSize = 0x1000; // enough for the headers of every image we care about
+
+	// Returns false if `data` doesn't start with valid PE headers
+	bool ParseHeaders(const uint8_t *data, size_t size, Headers &out);
+}
\ No newline at end of file
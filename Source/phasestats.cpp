@@ -0,0 +1,185 @@
+#include "phasestats.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// Log-linear buckets in microseconds, like an HDR histogram with 4 significant bits: values below 16us get a bucket each,
+	// every power of two above that is split into 16 buckets, so any value is off by at most 1/16 (~6%).
+	const int SubBits = 4;
+	const uint64_t SubCount = 1 << SubBits;
+	const int MaxExponent = 40; // ~12 days; anything longer lands in the last bucket
+	const size_t BucketCount = (MaxExponent - SubBits + 2) * SubCount; // exponents SubBits..MaxExponent, after the SubCount exact ones
+
+	using PhaseStats::GetBucket;
+	using PhaseStats::GetBucketFloor;
+
+	struct Histogram
+	{
+		std::atomic<uint64_t> buckets[BucketCount];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> total_us;
+		std::atomic<uint64_t> max_us;
+		std::atomic<uint64_t> bytes_read;
+		std::atomic<uint64_t> syscalls;
+
+		void Record(uint64_t us, size_t bytes, size_t reads)
+		{
+			buckets[GetBucket(us)].fetch_add(1, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+			total_us.fetch_add(us, std::memory_order_relaxed);
+			bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+			syscalls.fetch_add(reads, std::memory_order_relaxed);
+
+			uint64_t previous = max_us.load(std::memory_order_relaxed);
+			while (us > previous && !max_us.compare_exchange_weak(previous, us, std::memory_order_relaxed));
+		}
+
+		// Upper bound of the bucket holding the `fraction` quantile (never above the maximum)
+		uint64_t GetPercentile(const uint64_t *counts, uint64_t total, double fraction) const
+		{
+			const uint64_t rank = (uint64_t)(fraction * (double)(total - 1)) + 1;
+			const uint64_t max = max_us.load(std::memory_order_relaxed);
+			uint64_t seen = 0;
+
+			for (size_t i = 0; i + 1 < BucketCount; i++)
+			{
+				seen += counts[i];
+				if (seen >= rank)
+					return (std::min)(GetBucketFloor(i + 1) - 1, max);
+			}
+
+			return max;
+		}
+
+		void Reset()
+		{
+			for (auto &bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+			count.store(0, std::memory_order_relaxed);
+			total_us.store(0, std::memory_order_relaxed);
+			max_us.store(0, std::memory_order_relaxed);
+			bytes_read.store(0, std::memory_order_relaxed);
+			syscalls.store(0, std::memory_order_relaxed);
+		}
+	};
+
+	Histogram Histograms[(size_t)PhaseStats::Phase::Count]{}; // zero-initialized static storage
+
+	void PrintDuration(FILE *out, uint64_t us)
+	{
+		if (us < 10000)
+			fprintf(out, " %7lluus", (unsigned long long)us);
+		else
+			fprintf(out, " %7.1fms", us / 1000.0);
+	}
+}
+
+size_t PhaseStats::GetBucket(uint64_t us)
+{
+	if (us < SubCount)
+		return (size_t)us;
+
+	int exponent = 63;
+	while (!(us >> exponent)) exponent--;
+
+	if (exponent > MaxExponent)
+		return BucketCount - 1;
+
+	const uint64_t sub = (us >> (exponent - SubBits)) & (SubCount - 1);
+	return (size_t)((exponent - SubBits + 1) * SubCount + sub);
+}
+
+uint64_t PhaseStats::GetBucketFloor(size_t bucket)
+{
+	if (bucket < SubCount)
+		return bucket;
+
+	const int exponent = (int)(bucket / SubCount) + SubBits - 1;
+	const uint64_t sub = bucket % SubCount;
+	return (SubCount + sub) << (exponent - SubBits);
+}
+
+size_t PhaseStats::GetBucketCount()
+{
+	return BucketCount;
+}
+
+const char *PhaseStats::GetName(Phase phase)
+{
+	switch (phase)
+	{
+	case Phase::Enumerate: return "Enumerate";
+	case Phase::LoadModule: return "LoadModule";
+	case Phase::CachedOffsets: return "CachedOffsets";
+	case Phase::ImageScan: return "ImageScan";
+	case Phase::SnapshotFill: return "SnapshotFill";
+	case Phase::SignatureScan: return "SignatureScan";
+	case Phase::Rel32Resolve: return "Rel32Resolve";
+	case Phase::CandidateDeref: return "CandidateDeref";
+	case Phase::FrameDelaySearch: return "FrameDelaySearch";
+	case Phase::FirstWrite: return "FirstWrite";
+	case Phase::TimeToUnlock: return "TimeToUnlock";
+	default: return "?";
+	}
+}
+
+void PhaseStats::Record(Phase phase, std::chrono::steady_clock::duration elapsed, size_t bytes_read, size_t syscalls)
+{
+	const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+	Histograms[(size_t)phase].Record(us > 0 ? (uint64_t)us : 0, bytes_read, syscalls);
+}
+
+PhaseStats::Summary PhaseStats::GetSummary(Phase phase)
+{
+	const auto &histogram = Histograms[(size_t)phase];
+	Summary summary{};
+
+	// a consistent-enough copy: recording may go on meanwhile
+	std::vector<uint64_t> counts(BucketCount);
+	for (size_t i = 0; i < BucketCount; i++)
+	{
+		counts[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+		summary.count += counts[i];
+	}
+
+	if (summary.count == 0)
+		return summary;
+
+	summary.total_us = histogram.total_us.load(std::memory_order_relaxed);
+	summary.p50_us = histogram.GetPercentile(counts.data(), summary.count, 0.5);
+	summary.p90_us = histogram.GetPercentile(counts.data(), summary.count, 0.9);
+	summary.p99_us = histogram.GetPercentile(counts.data(), summary.count, 0.99);
+	summary.max_us = histogram.max_us.load(std::memory_order_relaxed);
+	summary.bytes_read = histogram.bytes_read.load(std::memory_order_relaxed);
+	summary.syscalls = histogram.syscalls.load(std::memory_order_relaxed);
+	return summary;
+}
+
+void PhaseStats::Dump(FILE *out)
+{
+	fprintf(out, "%-17s %8s %9s %9s %9s %9s %9s %12s %9s\n", "phase", "count", "mean", "p50", "p90", "p99", "max", "bytes read", "syscalls");
+
+	for (size_t i = 0; i < (size_t)Phase::Count; i++)
+	{
+		const Summary summary = GetSummary((Phase)i);
+		if (summary.count == 0)
+			continue;
+
+		fprintf(out, "%-17s %8llu", GetName((Phase)i), (unsigned long long)summary.count);
+		PrintDuration(out, summary.total_us / summary.count);
+		PrintDuration(out, summary.p50_us);
+		PrintDuration(out, summary.p90_us);
+		PrintDuration(out, summary.p99_us);
+		PrintDuration(out, summary.max_us);
+		fprintf(out, " %12llu %9llu\n", (unsigned long long)summary.bytes_read, (unsigned long long)summary.syscalls);
+	}
+
+	fflush(out);
+}
+
+void PhaseStats::Reset()
+{
+	for (auto &histogram : Histograms)
+		histogram.Reset();
+}
\ No newline at end of file
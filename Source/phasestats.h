@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "memorysource.h"
+
+// Process-wide latency histograms of every attach phase, so time-to-unlock can be broken down per client build.
+// Recording is a few relaxed atomic adds; nothing is locked or allocated. Dump prints everything recorded so far.
+namespace PhaseStats
+{
+	enum class Phase
+	{
+		Enumerate, // one pass over the process list
+		LoadModule, // finding the main module (each attempt)
+		CachedOffsets, // validating cached/shared offsets
+		ImageScan, // signature scan of the executable on disk
+		SnapshotFill, // bulk copy of the module's code sections
+		SignatureScan, // one signature (or signature set) over the code
+		Rel32Resolve, // from a signature hit to the TaskScheduler pointer
+		CandidateDeref, // reading every candidate pointer
+		FrameDelaySearch, // reading and searching each scheduler's frame delay window
+		FirstWrite, // first write of the cap
+		TimeToUnlock, // Begin to attached
+		Count
+	};
+
+	const char *GetName(Phase phase);
+
+	void Record(Phase phase, std::chrono::steady_clock::duration elapsed, size_t bytes_read = 0, size_t syscalls = 0);
+
+	struct Summary
+	{
+		uint64_t count = 0;
+		uint64_t total_us = 0;
+		uint64_t p50_us = 0;
+		uint64_t p90_us = 0;
+		uint64_t p99_us = 0;
+		uint64_t max_us = 0;
+		uint64_t bytes_read = 0;
+		uint64_t syscalls = 0;
+	};
+
+	// Everything recorded for `phase` so far
+	Summary GetSummary(Phase phase);
+
+	// Prints count, percentiles, I/O per phase
+	void Dump(FILE *out);
+	void Reset();
+
+	// The histograms' log-linear microsecond buckets: GetBucket(GetBucketFloor(i)) == i for every i < GetBucketCount()
+	size_t GetBucket(uint64_t us);
+	uint64_t GetBucketFloor(size_t bucket); // smallest value that falls into `bucket`
+	size_t GetBucketCount();
+
+	// Records the time from construction to destruction (or Stop), plus the reads `source` made meanwhile
+	class Timer
+	{
+	public:
+		explicit Timer(Phase phase, ProcUtil::MemorySource *source = nullptr)
+			: phase(phase), source(source), start(std::chrono::steady_clock::now())
+		{
+			if (source) io = source->GetIoStats();
+		}
+
+		~Timer()
+		{
+			Stop();
+		}
+
+		Timer(const Timer &) = delete;
+		Timer &operator=(const Timer &) = delete;
+
+		void Stop()
+		{
+			if (stopped)
+				return;
+
+			stopped = true;
+
+			ProcUtil::ScanStats delta{};
+			if (source)
+			{
+				const auto now = source->GetIoStats();
+				delta = { now.bytes_read - io.bytes_read, now.syscalls - io.syscalls };
+			}
+
+			Record(phase, std::chrono::steady_clock::now() - start, delta.bytes_read, delta.syscalls);
+		}
+
+		// Not recorded (e.g. the attempt was cancelled)
+		void Discard()
+		{
+			stopped = true;
+		}
+
+	private:
+		Phase phase;
+		ProcUtil::MemorySource *source;
+		std::chrono::steady_clock::time_point start;
+		ProcUtil::ScanStats io{};
+		bool stopped = false;
+	};
+}
\ No newline at end of file
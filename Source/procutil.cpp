@@ -1,12 +1,10 @@
 #include "procutil.h"
+#include "log.h"
 
 #include <TlHelp32.h>
+#include <cstring>
 #include <filesystem>
 
-#include "sigscan.h"
-
-#define READ_LIMIT (1024 * 1024 * 2) // 2 MB
-
 std::vector<DWORD> ProcUtil::GetProcessIdsByImageName(const char *image_name, size_t limit)
 {
 	std::vector<DWORD> result;
@@ -17,19 +15,69 @@ std::vector<DWORD> ProcUtil::GetProcessIdsByImageName(const char *image_name, si
 	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, NULL);
 	size_t count = 0;
 
-	if (Process32First(snapshot, &entry) == TRUE)
+	if (snapshot == INVALID_HANDLE_VALUE)
+		return result;
+
+	// the first entry counts too (it used to be skipped by starting at Process32Next)
+	for (BOOL more = Process32First(snapshot, &entry); more && count < limit; more = Process32Next(snapshot, &entry))
 	{
-		while (count < limit && Process32Next(snapshot, &entry) == TRUE)
+		if (_stricmp(entry.szExeFile, image_name) == 0)
 		{
-			if (_stricmp(entry.szExeFile, image_name) == 0)
+			result.push_back(entry.th32ProcessID);
+			count++;
+		}
+	}
+
+	CloseHandle(snapshot);
+	return result;
+}
+
+std::vector<ProcUtil::ProcessMatch> ProcUtil::FindProcessesByImageNames(const std::vector<const char *> &image_names)
+{
+	std::vector<ProcessMatch> result;
+	if (image_names.empty())
+		return result;
+
+	std::vector<size_t> lengths;
+	for (const char *name : image_names)
+		lengths.push_back(strlen(name));
+
+	PROCESSENTRY32 entry;
+	entry.dwSize = sizeof(PROCESSENTRY32);
+
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, NULL);
+	if (snapshot == INVALID_HANDLE_VALUE)
+		return result;
+
+	for (BOOL more = Process32First(snapshot, &entry); more; more = Process32Next(snapshot, &entry))
+	{
+		const size_t length = strlen(entry.szExeFile);
+
+		for (size_t i = 0; i < image_names.size(); i++)
+		{
+			if (length == lengths[i] && _stricmp(entry.szExeFile, image_names[i]) == 0)
 			{
-				result.push_back(entry.th32ProcessID);
-				count++;
+				result.push_back({ entry.th32ProcessID, i, 0 });
+				break;
 			}
 		}
 	}
 
 	CloseHandle(snapshot);
+
+	// only for the (few) matches, Toolhelp doesn't report it
+	for (auto &match : result)
+	{
+		if (HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, match.id))
+		{
+			FILETIME creation, exit, kernel, user;
+			if (GetProcessTimes(process, &creation, &exit, &kernel, &user))
+				match.start_time = ((uint64_t)creation.dwHighDateTime << 32) | creation.dwLowDateTime;
+
+			CloseHandle(process);
+		}
+	}
+
 	return result;
 }
 
@@ -93,7 +141,7 @@ ProcUtil::ModuleInfo ProcUtil::GetMainModuleInfo(HANDLE process)
 	ModuleInfo result{};
 	bool found;
 
-	printf("[ProcUtil] QueryFullProcessImageName(%p) returned %s\n", process, buffer);
+	RFU_LOG(Debug, ProcUtil, "[ProcUtil] QueryFullProcessImageName(%p) returned %s\n", process, buffer);
 
 	try
 	{
@@ -101,7 +149,7 @@ ProcUtil::ModuleInfo ProcUtil::GetMainModuleInfo(HANDLE process)
 	}
 	catch (WindowsException& e)
 	{
-		printf("[ProcUtil] GetModuleInfo(%p, NULL) failed: %s (%X)\n", process, e.what(), e.GetLastError());
+		RFU_LOG(Warning, ProcUtil, "[ProcUtil] GetModuleInfo(%p, NULL) failed: %s (%X)\n", process, e.what(), e.GetLastError());
 		found = false;
 	}
 
@@ -117,13 +165,13 @@ ProcUtil::ModuleInfo ProcUtil::GetMainModuleInfo(HANDLE process)
 
 bool ProcUtil::FindModuleInfo(HANDLE process, const std::filesystem::path& path, ModuleInfo& out)
 {
-	printf("[ProcUtil] FindModuleInfo(%p, %s)\n", process, path.string().c_str());
+	RFU_LOG(Debug, ProcUtil, "[ProcUtil] FindModuleInfo(%p, %s)\n", process, path.string().c_str());
 
 	for (const auto &info : GetProcessModules(process))
 	{
 		try
 		{
-			printf("\tbase=%p, size=%zu, path=%s\n", info.base, info.size, info.path.string().c_str());
+			RFU_LOG(Debug, ProcUtil, "\tbase=%p, size=%zu, path=%s\n", info.base, info.size, info.path.string().c_str());
 
 			if (std::filesystem::equivalent(info.path, path))
 			{
@@ -139,66 +187,79 @@ bool ProcUtil::FindModuleInfo(HANDLE process, const std::filesystem::path& path,
 	return false;
 }
 
-void *ScanRegion(HANDLE process, const char *aob, const char *mask, const uint8_t *base, size_t size)
+ProcUtil::Win32MemorySource::Win32MemorySource(HANDLE process)
+	: process(process)
 {
-	std::vector<uint8_t> buffer;
-	buffer.resize(READ_LIMIT);
+}
 
-	size_t aob_len = strlen(mask);
+bool ProcUtil::Win32MemorySource::Is64Bit()
+{
+	if (!is_64bit.has_value())
+		is_64bit = IsProcess64Bit(process);
 
-	while (size >= aob_len)
-	{
-		size_t bytes_read = 0;
+	return *is_64bit;
+}
 
-		if (ReadProcessMemory(process, base, buffer.data(), size < buffer.size() ? size : buffer.size(), (SIZE_T *)&bytes_read) && bytes_read >= aob_len)
-		{
-			if (uint8_t *result = sigscan::scan(aob, mask, (uintptr_t)buffer.data(), (uintptr_t)buffer.data() + bytes_read))
-			{
-				return (uint8_t *)base + (result - buffer.data());
-			}
-		}
-		else
-		{
-			return nullptr;
-		}
-	   
-		if (bytes_read > aob_len) bytes_read -= aob_len;
+bool ProcUtil::Win32MemorySource::Read(const void *address, void *buffer, size_t size, size_t *bytes_read)
+{
+	SIZE_T copied = 0;
+	const bool success = ReadProcessMemory(process, address, buffer, size, &copied) != 0;
+	CountRead(copied);
 
-		size -= bytes_read;
-		base += bytes_read;
-	}
+	if (bytes_read) *bytes_read = copied;
+	return success && copied == size;
+}
 
-	return nullptr;
+bool ProcUtil::Win32MemorySource::Write(const void *address, const void *buffer, size_t size)
+{
+	return WriteProcessMemory(process, (LPVOID)address, buffer, size, NULL) != 0;
 }
 
+bool ProcUtil::Win32MemorySource::QueryRegion(const void *address, MemoryRegion &out)
+{
+	MEMORY_BASIC_INFORMATION mbi;
+	if (!VirtualQueryEx(process, address, &mbi, sizeof(mbi)))
+		return false;
 
-void *ProcUtil::ScanProcess(HANDLE process, const char *aob, const char *mask, const uint8_t *start, const uint8_t *end)
+	out.base = (const uint8_t *)mbi.BaseAddress;
+	out.size = mbi.RegionSize;
+	out.readable = mbi.State & MEM_COMMIT && mbi.Protect & PAGE_READABLE && !(mbi.Protect & PAGE_GUARD);
+	return true;
+}
+
+std::vector<ProcUtil::ModuleInfo> ProcUtil::Win32MemorySource::GetModules()
 {
-	auto i = start;
+	return GetProcessModules(process);
+}
 
-	while (i < end)
-	{
-		MEMORY_BASIC_INFORMATION mbi;
-		if (!VirtualQueryEx(process, i, &mbi, sizeof(mbi)))
-		{
-			return nullptr;
-		}
+bool ProcUtil::Win32MemorySource::GetMainModule(ModuleInfo &out)
+{
+	out = GetMainModuleInfo(process);
+	return out.base != nullptr;
+}
 
-		size_t size = mbi.RegionSize - (i - (const uint8_t *)mbi.BaseAddress);
-		if (i + size >= end) size = end - i;
+void *ProcUtil::ScanProcess(HANDLE process, const char *aob, const char *mask, const uint8_t *start, const uint8_t *end)
+{
+	Win32MemorySource source(process);
+	return ScanProcess(source, aob, mask, start, end);
+}
 
-		if (mbi.State & MEM_COMMIT && mbi.Protect & PAGE_READABLE && !(mbi.Protect & PAGE_GUARD))
-		{
-			if (void *result = ScanRegion(process, aob, mask, i, size))
-			{
-				return result;
-			}
-		}
+void *ProcUtil::ScanProcessParallel(HANDLE process, const char *aob, const char *mask, ThreadPool &pool, const uint8_t *start, const uint8_t *end)
+{
+	Win32MemorySource source(process);
+	return ScanProcessParallel(source, aob, mask, pool, start, end);
+}
 
-		i += size;
-	}
+bool ProcUtil::ScanProcessAll(HANDLE process, const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start, const uint8_t *end, ScanStats *stats)
+{
+	Win32MemorySource source(process);
+	return ScanProcessAll(source, aob, mask, callback, start, end, stats);
+}
 
-	return nullptr;
+bool ProcUtil::ScanProcess(HANDLE process, const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start, const uint8_t *end, ScanStats *stats)
+{
+	Win32MemorySource source(process);
+	return ScanProcess(source, patterns, callback, start, end, stats);
 }
 
 bool ProcUtil::IsOS64Bit()
@@ -228,4 +289,4 @@ bool ProcUtil::IsProcess64Bit(HANDLE process)
 	{
 		return false;
 	}
-}
+}
\ No newline at end of file
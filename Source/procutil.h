@@ -7,6 +7,9 @@
 #include <string>
 #include <filesystem>
 #include <optional>
+#include <functional>
+
+#include "memorysource.h"
 
 #define PAGE_READABLE (PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_READONLY | PAGE_READWRITE)
 
@@ -14,31 +17,48 @@ namespace ProcUtil
 {
 	// Problem: Calling GetLastError() in a catch block is sketchy/unreliable as Windows' internal exception handling _may_ call WinAPI functions beforehand that change the error. Better safe than sorry.
 	// Solution: This class
-	class WindowsException : public std::runtime_error
+	class WindowsException : public MemoryException
 	{
 	public:
 		WindowsException(const char *message)
-			: std::runtime_error(init(message))
+			: MemoryException(message, ::GetLastError())
 		{
 		}
+	};
 
-		DWORD GetLastError() const
-		{
-			return last_error;
-		}
+	struct ProcessInfo;
+
+	// MemorySource over a process handle (needs PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, plus PROCESS_VM_WRITE | PROCESS_VM_OPERATION to write).
+	// The handle isn't owned.
+	class Win32MemorySource : public MemorySource
+	{
+	public:
+		explicit Win32MemorySource(HANDLE process);
+
+		const void *GetTag() const override { return process; }
+		bool Is64Bit() override;
+
+		bool Read(const void *address, void *buffer, size_t size, size_t *bytes_read = nullptr) override;
+		bool Write(const void *address, const void *buffer, size_t size) override;
+		bool QueryRegion(const void *address, MemoryRegion &out) override;
+
+		std::vector<ModuleInfo> GetModules() override;
+		bool GetMainModule(ModuleInfo &out) override;
 
 	private:
-		const char *init(const char *message)
-		{
-			last_error = ::GetLastError();
-			return message;
-		}
+		HANDLE process;
+		std::optional<bool> is_64bit;
+	};
 
-		DWORD last_error;
+	struct ProcessMatch
+	{
+		DWORD id;
+		size_t image; // index of the matching name
+		uint64_t start_time; // FILETIME, tells a reused pid apart from the process it used to be; 0 if it couldn't be queried
 	};
 
-	struct ModuleInfo;
-	struct ProcessInfo;
+	// Matches every process against all of `image_names` (case-insensitively) in a single snapshot
+	std::vector<ProcessMatch> FindProcessesByImageNames(const std::vector<const char *> &image_names);
 
 	std::vector<DWORD> GetProcessIdsByImageName(const char *image_name, size_t limit = -1);
 	std::vector<HANDLE> GetProcessesByImageName(const char *image_name, DWORD access, size_t limit = -1);
@@ -47,7 +67,12 @@ namespace ProcUtil
 	std::vector<ModuleInfo> GetProcessModules(HANDLE process);
 	ModuleInfo GetMainModuleInfo(HANDLE process);
 	bool FindModuleInfo(HANDLE process, const std::filesystem::path& name, ModuleInfo& out);
+
+	// Shorthands for the MemorySource scans in memorysource.h
 	void *ScanProcess(HANDLE process, const char *aob, const char *mask, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX);
+	void *ScanProcessParallel(HANDLE process, const char *aob, const char *mask, ThreadPool &pool, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX);
+	bool ScanProcessAll(HANDLE process, const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX, ScanStats *stats = nullptr);
+	bool ScanProcess(HANDLE process, const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start = nullptr, const uint8_t *end = (const uint8_t *)UINTPTR_MAX, ScanStats *stats = nullptr);
 	
 	bool IsOS64Bit();
 	bool IsProcess64Bit(HANDLE process);
@@ -81,18 +106,6 @@ namespace ProcUtil
 		if (!WriteProcessMemory(process, (LPVOID) location, (LPCVOID) &value, sizeof(T), NULL)) throw WindowsException("unable to write process memory");
 	}
 
-	struct ModuleInfo
-	{
-		std::filesystem::path path;
-		void *base = nullptr;
-		size_t size = 0;
-
-		HMODULE GetHandle() const
-		{
-			return (HMODULE)base;
-		}
-	};
-
 	struct ProcessInfo
 	{
 		HANDLE handle = NULL;
@@ -0,0 +1,210 @@
+#include "regionmap.h"
+
+#include <algorithm>
+
+ProcUtil::RegionMap::RegionMap(MemorySource &source)
+	: source(source)
+{
+}
+
+// Binary search only, never queries the process
+bool ProcUtil::RegionMap::Lookup(const uint8_t *address, MemoryRegion &out) const
+{
+	auto it = std::upper_bound(regions.begin(), regions.end(), address, [](const uint8_t *value, const MemoryRegion &region)
+	{
+		return value < region.base;
+	});
+
+	if (it == regions.begin())
+		return false;
+
+	--it;
+	if ((size_t)(address - it->base) >= it->size)
+		return false;
+
+	out = *it;
+	return true;
+}
+
+bool ProcUtil::RegionMap::Query(const uint8_t *address, MemoryRegion &out)
+{
+	MemoryRegion region;
+	if (!source.QueryRegion(address, region))
+		return false;
+
+	const uint8_t *start = region.base;
+	const uint8_t *end = region.base + region.size;
+
+	if (address < start || address >= end)
+	{
+		out = region; // shouldn't happen, but don't let a bogus answer into the map
+		return true;
+	}
+
+	// only fill the hole `address` is in; the neighbours keep their own (possibly older) answers
+	auto next = std::upper_bound(regions.begin(), regions.end(), address, [](const uint8_t *value, const MemoryRegion &region)
+	{
+		return value < region.base;
+	});
+
+	if (next != regions.end() && next->base < end) end = next->base;
+	if (next != regions.begin() && std::prev(next)->base + std::prev(next)->size > start) start = std::prev(next)->base + std::prev(next)->size;
+
+	region.base = start;
+	region.size = end - start;
+	Insert(region, out);
+	return true;
+}
+
+// Inserts a region that doesn't overlap anything, merging it with neighbours of the same readability
+void ProcUtil::RegionMap::Insert(const MemoryRegion &region, MemoryRegion &merged)
+{
+	auto it = std::upper_bound(regions.begin(), regions.end(), region.base, [](const uint8_t *value, const MemoryRegion &entry)
+	{
+		return value < entry.base;
+	});
+
+	it = regions.insert(it, region);
+
+	if (it != regions.begin())
+	{
+		auto prev = std::prev(it);
+		if (prev->readable == it->readable && prev->base + prev->size == it->base)
+		{
+			prev->size += it->size;
+			it = std::prev(regions.erase(it));
+		}
+	}
+
+	auto next = std::next(it);
+	if (next != regions.end() && next->readable == it->readable && it->base + it->size == next->base)
+	{
+		it->size += next->size;
+		regions.erase(next);
+	}
+
+	merged = *it;
+}
+
+void ProcUtil::RegionMap::Remove(const uint8_t *start, const uint8_t *end)
+{
+	std::vector<MemoryRegion> kept;
+	kept.reserve(regions.size() + 1);
+
+	for (const auto &region : regions)
+	{
+		const uint8_t *region_end = region.base + region.size;
+
+		if (region_end <= start || region.base >= end)
+		{
+			kept.push_back(region);
+			continue;
+		}
+
+		// keep whatever sticks out on either side
+		if (region.base < start)
+			kept.push_back({ region.base, (size_t)(start - region.base), region.readable });
+		if (region_end > end)
+			kept.push_back({ end, (size_t)(region_end - end), region.readable });
+	}
+
+	regions = std::move(kept);
+}
+
+bool ProcUtil::RegionMap::Find(const void *address, MemoryRegion &out, size_t *queries)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	if (Lookup((const uint8_t *)address, out))
+		return true;
+
+	if (queries)
+		(*queries)++;
+
+	return Query((const uint8_t *)address, out);
+}
+
+bool ProcUtil::RegionMap::CheckReadable(const uint8_t *address, size_t size)
+{
+	const uint8_t *end = address + size;
+	if (end < address)
+		return false;
+
+	for (auto i = address; i < end;)
+	{
+		MemoryRegion region;
+		if (!Find(i, region) || !region.readable)
+			return false;
+
+		i = region.base + region.size;
+	}
+
+	return true;
+}
+
+bool ProcUtil::RegionMap::IsReadable(const void *address, size_t size)
+{
+	if (size == 0)
+		return true;
+
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	if (CheckReadable((const uint8_t *)address, size))
+		return true;
+
+	Invalidate(address, size);
+	return CheckReadable((const uint8_t *)address, size);
+}
+
+bool ProcUtil::RegionMap::FindModule(const void *address, ModuleInfo &out)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	if (!has_modules)
+	{
+		modules = source.GetModules();
+		std::sort(modules.begin(), modules.end(), [](const ModuleInfo &a, const ModuleInfo &b) { return a.base < b.base; });
+		has_modules = true;
+	}
+
+	auto it = std::upper_bound(modules.begin(), modules.end(), address, [](const void *value, const ModuleInfo &module)
+	{
+		return value < module.base;
+	});
+
+	if (it == modules.begin())
+		return false;
+
+	--it;
+	if ((size_t)((const uint8_t *)address - (const uint8_t *)it->base) >= it->size)
+		return false;
+
+	out = *it;
+	return true;
+}
+
+void ProcUtil::RegionMap::Invalidate(const void *address, size_t size)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	const uint8_t *start = (const uint8_t *)address;
+	const uint8_t *end = start + size < start ? (const uint8_t *)UINTPTR_MAX : start + size;
+	Remove(start, end);
+	source.FlushLayoutCache();
+}
+
+void ProcUtil::RegionMap::InvalidateAll()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	regions.clear();
+	modules.clear();
+	has_modules = false;
+	source.FlushLayoutCache();
+}
+
+size_t ProcUtil::RegionMap::GetRegionCount()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	return regions.size();
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "memorysource.h"
+
+namespace ProcUtil
+{
+	// Sorted copy of a process' address space layout, filled in lazily: a lookup in a part that was queried before is a binary
+	// search with no syscall, anything else is queried once and spliced in. Invalidate drops a range so it's queried again
+	// (after protection changes, new allocations, ...).
+	class RegionMap
+	{
+	public:
+		explicit RegionMap(MemorySource &source);
+
+		RegionMap(const RegionMap &) = delete;
+		RegionMap &operator=(const RegionMap &) = delete;
+
+		// The region containing `address`, same as MemorySource::QueryRegion; false past the end of the address space.
+		// `queries`, if given, is incremented when the process had to be queried. Answers are never refreshed on their own, an
+		// unreadable region included: callers that expect the layout to change (a client unpacking its code) Invalidate first,
+		// or use IsReadable.
+		bool Find(const void *address, MemoryRegion &out, size_t *queries = nullptr);
+
+		// True if all of [address, address + size) is readable. A negative answer is queried again once in case the map was stale.
+		bool IsReadable(const void *address, size_t size);
+
+		// The module containing `address`; the module list is loaded on first use
+		bool FindModule(const void *address, ModuleInfo &out);
+
+		void Invalidate(const void *address, size_t size);
+		void InvalidateAll();
+
+		size_t GetRegionCount();
+
+	private:
+		bool Lookup(const uint8_t *address, MemoryRegion &out) const;
+		bool Query(const uint8_t *address, MemoryRegion &out);
+		bool CheckReadable(const uint8_t *address, size_t size);
+		void Insert(const MemoryRegion &region, MemoryRegion &merged);
+		void Remove(const uint8_t *start, const uint8_t *end);
+
+		MemorySource &source;
+		std::recursive_mutex lock;
+
+		std::vector<MemoryRegion> regions; // sorted by base and never overlapping; holes are parts that haven't been queried yet
+		std::vector<ModuleInfo> modules; // sorted by base
+		bool has_modules = false;
+	};
+}
\ No newline at end of file
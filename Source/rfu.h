@@ -4,6 +4,9 @@
 #define RFU_GITHUB_REPO "axstin/rbxfpsunlocker"
 
 bool CheckForUpdates();
+void RunScanBenchmark();
+void NotifyError(const char *title, const char *error);
+void NotifyInfo(const char *title, const char *message);
 void RFU_SetFPSCap(double value);
 void RFU_OnUIUnlockMethodChange();
 void RFU_OnUIClose();
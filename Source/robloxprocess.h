@@ -0,0 +1,851 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "rfu.h"
+#include "settings.h"
+#include "memorysource.h"
+#include "snapshot.h"
+#include "regionmap.h"
+#include "pagecache.h"
+#include "mappedimage.h"
+#include "signatures.h"
+#include "offsetcache.h"
+#include "sharedoffsets.h"
+#include "phasestats.h"
+#include "log.h"
+#include "metrics.h"
+#include "nlohmann.hpp"
+
+// Platform independent: everything goes through a MemorySource, so the same logic drives Windows processes (main.cpp)
+// and Roblox running under Wine (linuxmain.cpp)
+
+enum class RobloxHandleType
+{
+	None,
+	Client,
+	UWP,
+	Studio
+};
+
+// discover -> module -> scan -> resolve -> write. Discovery is up to the front-end; everything after it is driven by RobloxProcess::Step
+enum class AttachState
+{
+	Discover,
+	Module, // waiting for the main module to be mapped
+	Scan, // looking for TaskScheduler pointer candidates (cached offsets, shared offsets or a signature scan)
+	Resolve, // looking for the frame delay behind the candidates
+	Write, // first write of the FPS cap
+	Attached,
+	Failed
+};
+
+class RobloxProcess
+{
+	static constexpr std::chrono::milliseconds FirstRetryWait{ 500 }; // scan/resolve retries back off from here...
+	static constexpr std::chrono::milliseconds MaxRetryWait{ 8000 }; // ...to here
+	static constexpr std::chrono::milliseconds SharedPollWait{ 250 }; // while another process scans this build (it wakes us when done)...
+	static constexpr std::chrono::seconds SharedWaitLimit{ 30 }; // ...for at most this long, then scan independently
+
+	std::unique_ptr<ProcUtil::MemorySource> memory;
+	std::unique_ptr<ProcUtil::ModuleSnapshot> snapshot; // kept across scan retries, dropped once the scan is over
+	AttachState state = AttachState::Discover;
+	std::atomic<bool> cancelled{ false };
+	std::chrono::steady_clock::time_point next_step{};
+	std::chrono::steady_clock::time_point attach_start{}; // for PhaseStats::Phase::TimeToUnlock
+	int module_tries_left = 5;
+	std::chrono::milliseconds module_wait{ 100 };
+	std::chrono::milliseconds retry_wait{ FirstRetryWait };
+	RobloxHandleType type = RobloxHandleType::None;
+	ProcUtil::ModuleInfo main_module{};
+	std::vector<const void *> ts_ptr_candidates; // task scheduler pointer candidates
+	const void *fd_ptr = nullptr; // frame delay pointer
+	bool use_flags_file = false;
+	int retries_left = 0;
+	OffsetCache::Fingerprint fingerprint{};
+	bool has_fingerprint = false;
+	bool tried_image_file = false;
+	const char *variant = "none"; // how the offsets were found, for Metrics::RecordAttach
+	bool waiting_for_shared = false; // see FindTaskSchedulerShared
+	std::chrono::steady_clock::time_point shared_wait_end{};
+
+	// Each StepX returns true if the state machine can move on right away, false if it has to wait for next_step (or is done)
+
+	void ScheduleRetry()
+	{
+		if (state != AttachState::Failed)
+			Metrics::RecordRetry(state == AttachState::Scan ? Metrics::Retry::Scan : Metrics::Retry::Resolve);
+
+		next_step = std::chrono::steady_clock::now() + retry_wait;
+		retry_wait = (std::min)(retry_wait * 2, MaxRetryWait);
+	}
+
+	void Fail()
+	{
+		snapshot.reset();
+		state = AttachState::Failed;
+		Metrics::RecordAttach(variant, false);
+	}
+
+	bool StepModule()
+	{
+		PhaseStats::Timer timer(PhaseStats::Phase::LoadModule, memory.get());
+		const bool found = memory->GetMainModule(main_module);
+		timer.Stop();
+
+		if (!found)
+		{
+			if (module_tries_left-- > 0)
+			{
+				RFU_LOG(Info, Attach, "[%p] Retrying in %lldms...\n", memory->GetTag(), (long long)module_wait.count());
+				next_step = std::chrono::steady_clock::now() + module_wait;
+				module_wait *= 2;
+				Metrics::RecordRetry(Metrics::Retry::Module);
+				return false;
+			}
+
+			if (cancelled)
+				return false;
+
+			NotifyError("rbxfpsunlocker Error", "Failed to get process base! Restart Roblox FPS Unlocker or, if you are on a 64-bit operating system, make sure you are using the 64-bit version of Roblox FPS Unlocker.");
+			Fail();
+			return false;
+		}
+
+		RFU_LOG(Info, Attach, "[%p] Process base: %p (size %zu)\n", memory->GetTag(), main_module.base, main_module.size);
+
+		// Small windows exist where we can attach to Roblox's security daemon while it isn't being debugged (see GetRobloxProcesses)
+		// As a secondary measure, check module size (daemon is about 1MB, client is about 80MB)
+		if (main_module.size < 1024 * 1024 * 10)
+		{
+			RFU_LOG(Info, Attach, "[%p] Ignoring security daemon process\n", memory->GetTag());
+			state = AttachState::Failed;
+			return false;
+		}
+
+		// the small reads until the offsets are resolved (headers, cached pointers, ...) are served from whole pages
+		memory->GetPageCache().SetEnabled(true);
+		LoadFingerprint();
+
+		state = AttachState::Scan;
+		OnUnlockMethodUpdate();
+		return true;
+	}
+
+	bool StepScan()
+	{
+		memory->GetPageCache().Invalidate(); // anything cached by an earlier attempt may have changed since
+
+		// looked up once per attempt, not again while waiting on another process' scan
+		if (!waiting_for_shared)
+		{
+			PhaseStats::Timer cached_timer(PhaseStats::Phase::CachedOffsets, memory.get());
+			const bool cached = TryCachedOffsets();
+			if (has_fingerprint)
+				cached_timer.Stop();
+			else
+				cached_timer.Discard(); // nothing to look up
+
+			if (cached)
+			{
+				state = AttachState::Write;
+				return true;
+			}
+		}
+
+		const auto start_time = std::chrono::steady_clock::now();
+		FindTaskSchedulerShared();
+
+		if (waiting_for_shared)
+		{
+			next_step = start_time + SharedPollWait;
+			return false;
+		}
+
+		if (ts_ptr_candidates.empty())
+		{
+			if (cancelled)
+				return false;
+
+			if (retries_left-- <= 0)
+			{
+				NotifyError("rbxfpsunlocker Error", "Unable to find TaskScheduler! This is probably due to a Roblox update-- watch the github for any patches or a fix.");
+				Fail();
+			}
+
+			ScheduleRetry();
+			return false;
+		}
+
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+		RFU_LOG(Info, Attach, "[%p] Found TaskScheduler candidates in %lldms\n", memory->GetTag(), elapsed);
+
+		snapshot.reset();
+		state = AttachState::Resolve;
+		return true;
+	}
+
+	void LoadFingerprint()
+	{
+		uint8_t header[PE::HeaderReadSize];
+		PE::Headers headers{};
+
+		if (memory->ReadCached(main_module.base, header, sizeof(header)) && PE::ParseHeaders(header, sizeof(header), headers))
+		{
+			fingerprint = OffsetCache::ComputeFingerprint(headers);
+			has_fingerprint = true;
+			RFU_LOG(Info, Attach, "[%p] Build fingerprint: %s\n", memory->GetTag(), fingerprint.ToString().c_str());
+		}
+	}
+
+	// Validates the offsets cached for this build with a few reads; on success no scanning is needed
+	bool TryCachedOffsets()
+	{
+		if (!has_fingerprint)
+			return false;
+
+		// another process of this build resolved everything already (no disk access), else whatever a past session stored
+		OffsetCache::Entry entry{};
+		SharedOffsets::Build shared{};
+		const bool from_shared = SharedOffsets::Lookup(fingerprint, shared) && shared.has_frame_delay;
+
+		if (from_shared)
+		{
+			entry.ts_ptr_rvas = shared.ts_ptr_rvas;
+			entry.frame_delay_offset = shared.frame_delay_offset;
+		}
+		else if (!OffsetCache::Lookup(fingerprint, entry))
+		{
+			return false;
+		}
+
+		const auto base = (const uint8_t *)main_module.base;
+		auto &regions = memory->GetRegions();
+
+		for (uint32_t rva : entry.ts_ptr_rvas)
+		{
+			if (rva >= main_module.size)
+				continue;
+
+			try
+			{
+				const void *ts_ptr = base + rva;
+				if (!regions.IsReadable(ts_ptr, memory->Is64Bit() ? sizeof(uint64_t) : sizeof(uint32_t)))
+					continue;
+
+				auto scheduler = (const uint8_t *)ProcUtil::ReadPointer(*memory, ts_ptr);
+				if (!scheduler || !regions.IsReadable(scheduler + entry.frame_delay_offset, sizeof(double)))
+					continue;
+
+				// anything between our minimum frame delay and 1 FPS could be a frame delay we or Roblox wrote
+				double frame_delay = ProcUtil::Read<double>(*memory, scheduler + entry.frame_delay_offset);
+				if (!(frame_delay >= 1.0 / 10000.0 - std::numeric_limits<double>::epsilon() && frame_delay <= 1.0))
+					continue;
+
+				RFU_LOG(Info, Attach, "[%p] Using %s offsets for build %s (scheduler %p, frame delay offset 0x%x)\n", memory->GetTag(), from_shared ? "shared" : "cached", fingerprint.ToString().c_str(), scheduler, entry.frame_delay_offset);
+
+				ts_ptr_candidates = { ts_ptr };
+				fd_ptr = scheduler + entry.frame_delay_offset;
+				variant = from_shared ? "shared" : "cached";
+				ReleasePageCache();
+				if (!from_shared)
+					StoreOffsets(ts_ptr, entry.frame_delay_offset); // refresh so this build isn't evicted
+				return true;
+			}
+			catch (ProcUtil::MemoryException &)
+			{
+			}
+		}
+
+		RFU_LOG(Info, Attach, "[%p] Cached offsets for build %s didn't validate, scanning\n", memory->GetTag(), fingerprint.ToString().c_str());
+		return false;
+	}
+
+	// The page cache only pays off while offsets are being resolved; once fd_ptr is known every read has to see live memory
+	void ReleasePageCache()
+	{
+		auto &cache = memory->GetPageCache();
+		if (!cache.IsEnabled())
+			return;
+
+		const auto stats = cache.GetStats();
+		RFU_LOG(Info, Attach, "[%p] Page cache: %zu hits, %zu misses, %zu evictions\n", memory->GetTag(), stats.hits, stats.misses, stats.evictions);
+		cache.SetEnabled(false);
+	}
+
+	// RVAs of the current candidates, `first` (if any) in front
+	std::vector<uint32_t> GetCandidateRvas(const void *first) const
+	{
+		const auto base = (const uint8_t *)main_module.base;
+		std::vector<uint32_t> rvas;
+
+		if (first)
+			rvas.push_back((uint32_t)((const uint8_t *)first - base));
+
+		for (const void *candidate : ts_ptr_candidates)
+		{
+			const auto rva = (const uint8_t *)candidate - base;
+			if (candidate != first && rva >= 0 && (size_t)rva < main_module.size)
+				rvas.push_back((uint32_t)rva);
+		}
+
+		return rvas;
+	}
+
+	void StoreOffsets(const void *ts_ptr, size_t delay_offset)
+	{
+		if (!has_fingerprint)
+			return;
+
+		OffsetCache::Entry entry{};
+		entry.frame_delay_offset = (uint32_t)delay_offset;
+		entry.ts_ptr_rvas = GetCandidateRvas(ts_ptr); // the winner first, then the other candidates in case a later session resolves differently
+
+		SharedOffsets::Build shared{};
+		shared.ts_ptr_rvas = entry.ts_ptr_rvas;
+		shared.frame_delay_offset = entry.frame_delay_offset;
+		shared.has_frame_delay = true;
+		SharedOffsets::Publish(fingerprint, shared);
+
+		if (!OffsetCache::Store(fingerprint, entry))
+			RFU_LOG(Warning, Attach, "[%p] Unable to update the offset cache\n", memory->GetTag());
+	}
+
+	bool IsLikelyAntiCheatProtected() const
+	{
+		return type != RobloxHandleType::Studio && memory->Is64Bit();
+	}
+
+	std::filesystem::path GetClientAppSettingsFilePath() const
+	{
+		return main_module.path.parent_path() / "ClientSettings" / "ClientAppSettings.json";
+	}
+
+	std::optional<int> FetchTargetFpsDiskValue(nlohmann::json *object_out = nullptr) const
+	{
+		std::ifstream file(GetClientAppSettingsFilePath());
+
+		if (file.is_open())
+		{
+			nlohmann::json object = nlohmann::json::parse(file, nullptr, false);
+			if (!object.is_discarded())
+			{
+				std::optional<int> result{};
+
+				if (object.contains("DFIntTaskSchedulerTargetFps"))
+				{
+					auto target_fps = object["DFIntTaskSchedulerTargetFps"];
+					if (target_fps.is_number_integer())
+					{
+						result = target_fps.get<int>();
+					}
+				}
+
+				if (object_out)
+					*object_out = std::move(object);
+
+				return result;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	bool IsTargetFpsFlagActive() const
+	{
+		auto value = FetchTargetFpsDiskValue();
+		return value.has_value() && *value > 0;
+	}
+
+	void WriteFlagsFile(int cap)
+	{
+		// todo: add support for registry read
+
+		if (cap == 0) cap = 5588562;
+
+		auto settings_file_path = GetClientAppSettingsFilePath();
+		RFU_LOG(Info, Attach, "[%p] Updating DFIntTaskSchedulerTargetFps in %ls to %d\n", memory->GetTag(), settings_file_path.wstring().c_str(), cap);
+
+		nlohmann::json object{};
+
+		// read
+		auto current_cap = FetchTargetFpsDiskValue(&object);
+		if ((current_cap.has_value() && *current_cap == cap) || (!current_cap.has_value() && cap < 0))
+		{
+			return;
+		}
+
+		// update
+		object["DFIntTaskSchedulerTargetFps"] = cap;
+
+		// try write
+		{
+			std::error_code ec{};
+			std::filesystem::create_directory(settings_file_path.parent_path(), ec);
+
+			std::ofstream file(settings_file_path);
+			if (!file.is_open())
+			{
+				Metrics::RecordFlagsFileWrite(false);
+				if (cancelled)
+				{
+					RFU_LOG(Warning, Attach, "[%p] Failed to write %ls\n", memory->GetTag(), settings_file_path.wstring().c_str());
+					return;
+				}
+
+				NotifyError("rbxfpsunlocker Error", "Failed to write ClientAppSettings.json! If running the Windows Store version of Roblox, try running Roblox FPS Unlocker as administrator or using a different unlock method.");
+				return;
+			}
+			file << object.dump(4);
+			Metrics::RecordFlagsFileWrite(file.good());
+		}
+
+		// prompt, unless we're exiting and nobody is left to dismiss it
+		if (cancelled)
+			return;
+
+		char message[512]{};
+		snprintf(message, sizeof(message), "Set DFIntTaskSchedulerTargetFps to %d in %ls\n\nRestarting Roblox may be required for changes to take effect.", cap, settings_file_path.wstring().c_str());
+		NotifyInfo("rbxfpsunlocker", message);
+	}
+
+	void SetFPSCapInMemory(double cap)
+	{
+		if (fd_ptr)
+		{
+			try
+			{
+				static const double min_frame_delay = 1.0 / 10000.0;
+				double frame_delay = cap <= 0.0 ? min_frame_delay : 1.0 / cap;
+
+				ProcUtil::Write(*memory, fd_ptr, frame_delay);
+			} catch (ProcUtil::MemoryException &e)
+			{
+				RFU_LOG(Warning, Attach, "[%p] RobloxProcess::SetFPSCapInMemory failed: %s (%d)\n", memory->GetTag(), e.what(), e.GetLastError());
+			}
+		}
+	}
+
+	bool FindTaskScheduler()
+	{
+		try
+		{
+			const auto tag = memory->GetTag();
+			const bool is_64bit = memory->Is64Bit();
+
+			// The executable on disk is much cheaper to scan than the live process. Only tried once per attach,
+			// since a Byfron client's code is encrypted on disk and always ends up being scanned live
+			if (!tried_image_file)
+			{
+				tried_image_file = true;
+
+				PhaseStats::Timer timer(PhaseStats::Phase::ImageScan);
+				MappedImage image(main_module.path, main_module.base);
+				if (image.IsOpen() && IsSameBuild(image.GetHeaders()))
+				{
+					if (Signatures::FindTaskSchedulerPointers(image, is_64bit, tag, ts_ptr_candidates, &variant))
+					{
+						RFU_LOG(Info, Attach, "[%p] Resolved from %ls\n", tag, main_module.path.wstring().c_str());
+						return true;
+					}
+				}
+			}
+
+			// a Byfron client changes the protection of its pages while it unpacks, so every attempt starts from a fresh view of the module
+			memory->GetRegions().Invalidate(main_module.base, main_module.size);
+
+			// one bulk read of the code sections; every scan and code read is served from the local copy. A retry refills the
+			// snapshot of the previous attempt rather than allocating another one
+			if (snapshot)
+			{
+				snapshot->InvalidateAll();
+				snapshot->ResetStats();
+			}
+			else
+			{
+				snapshot = std::make_unique<ProcUtil::ModuleSnapshot>(*memory, main_module);
+				snapshot->SetCancelFlag(&cancelled);
+			}
+
+			PhaseStats::Timer fill_timer(PhaseStats::Phase::SnapshotFill, memory.get());
+			snapshot->Fill();
+			if (cancelled)
+				fill_timer.Discard(); // partial
+			fill_timer.Stop();
+
+			const bool found = Signatures::FindTaskSchedulerPointers(*snapshot, is_64bit, tag, ts_ptr_candidates, &variant);
+
+			const auto &stats = snapshot->GetStats();
+			RFU_LOG(Info, Attach, "[%p] Module snapshot: %zu bytes read, %zu syscalls\n", tag, stats.bytes_read, stats.syscalls);
+
+			return found;
+		}
+		catch (ProcUtil::MemoryException &e)
+		{
+		}
+
+		return false;
+	}
+
+	// Same-build processes share their module layout, so candidates another process scanned for only need rebasing. Only one
+	// process per build scans at a time; the others set waiting_for_shared and are stepped again once it published its result
+	// (AttachPipeline listens to SharedOffsets), instead of blocking a pool thread on it.
+	bool FindTaskSchedulerShared()
+	{
+		const bool was_waiting = waiting_for_shared;
+		waiting_for_shared = false;
+
+		if (!has_fingerprint)
+			return FindTaskScheduler();
+
+		SharedOffsets::Build build{};
+		const auto acquired = SharedOffsets::Acquire(fingerprint, build);
+
+		if (acquired == SharedOffsets::AcquireResult::Pending)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			if (!was_waiting)
+				shared_wait_end = now + SharedWaitLimit;
+
+			if (now < shared_wait_end)
+			{
+				waiting_for_shared = true;
+				return false;
+			}
+
+			// the owner is taking too long; scan independently rather than stall this process
+			RFU_LOG(Info, Attach, "[%p] Gave up waiting for another process to scan build %s\n", memory->GetTag(), fingerprint.ToString().c_str());
+		}
+
+		if (acquired == SharedOffsets::AcquireResult::Resolved)
+		{
+			const auto base = (const uint8_t *)main_module.base;
+			for (uint32_t rva : build.ts_ptr_rvas)
+			{
+				if (rva < main_module.size)
+					ts_ptr_candidates.push_back(base + rva);
+			}
+
+			RFU_LOG(Info, Attach, "[%p] Reusing %zu TaskScheduler candidates resolved for build %s\n", memory->GetTag(), ts_ptr_candidates.size(), fingerprint.ToString().c_str());
+			variant = "shared";
+			return !ts_ptr_candidates.empty();
+		}
+
+		const bool found = FindTaskScheduler();
+
+		if (acquired == SharedOffsets::AcquireResult::Owner)
+		{
+			if (found)
+			{
+				SharedOffsets::Build shared{};
+				shared.ts_ptr_rvas = GetCandidateRvas(nullptr);
+				SharedOffsets::Publish(fingerprint, shared);
+			}
+			else
+			{
+				SharedOffsets::Release(fingerprint);
+			}
+		}
+
+		return found;
+	}
+
+	bool IsSameBuild(const PE::Headers &headers) const
+	{
+		if (has_fingerprint)
+			return OffsetCache::ComputeFingerprint(headers).header_hash == fingerprint.header_hash;
+
+		return headers.size_of_image == main_module.size;
+	}
+
+	static const size_t FrameDelaySearchOffset = 0x100; // ProcUtil::IsProcess64Bit(process) ? 0x200 : 0x100;
+	static const size_t FrameDelaySearchSize = 0x100;
+
+	// `window` holds FrameDelaySearchSize bytes read from scheduler + FrameDelaySearchOffset
+	static size_t FindTaskSchedulerFrameDelayOffset(const uint8_t *window)
+	{
+		/* Find the frame delay variable inside TaskScheduler (ugly, but it should survive updates unless the variable is removed or shifted)
+		   (variable was at +0x150 (32-bit) and +0x180 (studio 64-bit) as of 2/13/2020) */
+		for (size_t i = 0; i < FrameDelaySearchSize - sizeof(double); i += 4)
+		{
+			static const double frame_delay = 1.0 / 60.0;
+			double difference = *(double *)(window + i) - frame_delay;
+			difference = difference < 0 ? -difference : difference;
+			if (difference < std::numeric_limits<double>::epsilon()) return FrameDelaySearchOffset + i;
+		}
+
+		return -1;
+	}
+
+	bool StepResolve()
+	{
+		// two batched rounds instead of two reads per candidate: every pointer first, then every scheduler's search window
+		const size_t count = ts_ptr_candidates.size();
+		const size_t pointer_size = memory->Is64Bit() ? sizeof(uint64_t) : sizeof(uint32_t);
+
+		PhaseStats::Timer deref_timer(PhaseStats::Phase::CandidateDeref, memory.get());
+
+		std::vector<uint64_t> pointers(count, 0);
+		std::vector<ProcUtil::ReadRequest> requests(count);
+		for (size_t i = 0; i < count; i++)
+			requests[i] = { ts_ptr_candidates[i], &pointers[i], pointer_size };
+
+		memory->ReadMany(requests.data(), requests.size());
+
+		auto &regions = memory->GetRegions();
+		std::vector<size_t> owners; // candidate index of each scheduler
+		size_t unreadable = 0;
+		size_t fail_count = 0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (requests[i].bytes_read != pointer_size)
+			{
+				RFU_LOG(Debug, Attach, "[%p] Unable to read ts_ptr (%p)\n", memory->GetTag(), ts_ptr_candidates[i]);
+				unreadable++;
+			}
+			else if (pointers[i] == 0)
+			{
+				RFU_LOG(Debug, Attach, "[%p] *ts_ptr (%p) == nullptr\n", memory->GetTag(), ts_ptr_candidates[i]);
+			}
+			else
+			{
+				const auto scheduler = (const uint8_t *)(uintptr_t)pointers[i];
+				ProcUtil::ModuleInfo owner;
+
+				if (regions.FindModule(scheduler, owner))
+					RFU_LOG(Info, Attach, "[%p] Potential task scheduler: %p (inside %ls)\n", memory->GetTag(), scheduler, owner.path.filename().wstring().c_str());
+				else
+					RFU_LOG(Info, Attach, "[%p] Potential task scheduler: %p\n", memory->GetTag(), scheduler);
+
+				// don't bother reading windows that aren't mapped
+				if (regions.IsReadable(scheduler + FrameDelaySearchOffset, FrameDelaySearchSize))
+					owners.push_back(i);
+				else
+					fail_count++;
+			}
+		}
+
+		deref_timer.Stop();
+		PhaseStats::Timer search_timer(PhaseStats::Phase::FrameDelaySearch, memory.get());
+
+		std::vector<uint8_t> windows(owners.size() * FrameDelaySearchSize);
+		requests.resize(owners.size());
+		for (size_t j = 0; j < owners.size(); j++)
+			requests[j] = { (const uint8_t *)(uintptr_t)pointers[owners[j]] + FrameDelaySearchOffset, windows.data() + j * FrameDelaySearchSize, FrameDelaySearchSize };
+
+		memory->ReadMany(requests.data(), requests.size());
+
+		for (size_t j = 0; j < owners.size(); j++)
+		{
+			size_t delay_offset = requests[j].bytes_read == FrameDelaySearchSize ? FindTaskSchedulerFrameDelayOffset(windows.data() + j * FrameDelaySearchSize) : -1;
+			if (delay_offset == (size_t)-1)
+			{
+				fail_count++;
+				continue; // try next
+			}
+
+			// winner
+			search_timer.Stop();
+			const auto scheduler = (const uint8_t *)(uintptr_t)pointers[owners[j]];
+			RFU_LOG(Info, Attach, "[%p] Frame delay offset: %zu (0x%zx)\n", memory->GetTag(), delay_offset, delay_offset);
+			fd_ptr = scheduler + delay_offset;
+			ReleasePageCache();
+			StoreOffsets(ts_ptr_candidates[owners[j]], delay_offset);
+
+			state = AttachState::Write;
+			return true;
+		}
+
+		search_timer.Stop();
+
+		if (cancelled)
+			return false;
+
+		if (fail_count > 0)
+		{
+			// one or more candidates had valid pointers with no frame delay variable
+			if (retries_left-- <= 0)
+			{
+				NotifyError("rbxfpsunlocker Error", "Variable scan failed! Make sure your framerate is at ~60.0 FPS (press Shift+F5 in-game) before using Roblox FPS Unlocker.");
+				Fail();
+			}
+		}
+		else if (unreadable > 0)
+		{
+			if (retries_left-- <= 0)
+			{
+				NotifyError("rbxfpsunlocker Error", "An exception occurred while performing the variable scan.");
+				Fail();
+			}
+		}
+
+		ScheduleRetry();
+		return false;
+	}
+
+public:
+	ProcUtil::MemorySource &GetMemory() const
+	{
+		return *memory;
+	}
+
+	AttachState GetState() const
+	{
+		return state;
+	}
+
+	// Attached, failed or cancelled: Step has nothing left to do
+	bool IsDone() const
+	{
+		return cancelled || state == AttachState::Attached || state == AttachState::Failed;
+	}
+
+	// Another process of the same build is scanning; the next step is worth running as soon as it's done
+	bool IsWaitingForSharedOffsets() const
+	{
+		return waiting_for_shared && state == AttachState::Scan && !IsDone();
+	}
+
+	std::chrono::steady_clock::time_point GetNextStepTime() const
+	{
+		return next_step;
+	}
+
+	// Safe to call from any thread; a step in progress gives up at its next check and no further steps run
+	void Cancel()
+	{
+		cancelled = true;
+	}
+
+	void Begin(std::unique_ptr<ProcUtil::MemorySource> source, RobloxHandleType handle_type, int retry_count)
+	{
+		memory = std::move(source);
+		type = handle_type;
+		retries_left = retry_count;
+		state = AttachState::Module;
+		next_step = attach_start = std::chrono::steady_clock::now();
+
+		RFU_LOG(Info, Attach, "[%p] Finding process base...\n", memory->GetTag());
+	}
+
+	// Runs the attach state machine until it has to wait (see GetNextStepTime) or is done
+	void Step()
+	{
+		while (!cancelled)
+		{
+			// switching to FlagsFile mode mid-attach makes the memory offsets unnecessary
+			if (use_flags_file && (state == AttachState::Scan || state == AttachState::Resolve))
+			{
+				state = AttachState::Attached;
+				Metrics::RecordAttach("flags-file", true);
+			}
+
+			bool proceed = false;
+
+			switch (state)
+			{
+			case AttachState::Module: proceed = StepModule(); break;
+			case AttachState::Scan: proceed = StepScan(); break;
+			case AttachState::Resolve: proceed = StepResolve(); break;
+			case AttachState::Write:
+			{
+				PhaseStats::Timer timer(PhaseStats::Phase::FirstWrite, memory.get());
+				SetFPSCap(Settings::FPSCap);
+				timer.Stop();
+
+				PhaseStats::Record(PhaseStats::Phase::TimeToUnlock, std::chrono::steady_clock::now() - attach_start);
+				Metrics::RecordAttach(use_flags_file ? "flags-file" : variant, true);
+				state = AttachState::Attached;
+				break;
+			}
+			default:
+				break;
+			}
+
+			if (!proceed)
+				return;
+		}
+	}
+
+	// Blocking attach for one-shot use (console mode): waits out the module backoff (and any same-build scan in progress) and
+	// makes one scan/resolve attempt
+	bool Attach(std::unique_ptr<ProcUtil::MemorySource> source, RobloxHandleType handle_type, int retry_count)
+	{
+		Begin(std::move(source), handle_type, retry_count);
+
+		while (true)
+		{
+			Step();
+
+			if ((state != AttachState::Module && !IsWaitingForSharedOffsets()) || IsDone())
+				break;
+
+			std::this_thread::sleep_until(next_step);
+		}
+
+		return fd_ptr != nullptr;
+	}
+
+	// Until the module is known there is no settings file path or frame delay; StepModule applies the current settings then
+	bool HasModule() const
+	{
+		return state != AttachState::Discover && state != AttachState::Module;
+	}
+
+	void SetFPSCap(double cap)
+	{
+		if (!HasModule())
+			return;
+
+		if (use_flags_file)
+		{
+			WriteFlagsFile(cap);
+		}
+		else
+		{
+			SetFPSCapInMemory(cap);
+		}
+	}
+
+	void OnUIClose()
+	{
+		SetFPSCapInMemory(60.0);
+	}
+
+	void OnUnlockMethodUpdate()
+	{
+		if (!HasModule())
+			return;
+
+		if (Settings::UnlockMethod == Settings::UnlockMethodType::FlagsFile
+			|| (Settings::UnlockMethod == Settings::UnlockMethodType::Hybrid && IsLikelyAntiCheatProtected()))
+		{
+			RFU_LOG(Info, Attach, "[%p] Using FlagsFile mode\n", memory->GetTag());
+			use_flags_file = true;
+			WriteFlagsFile(Settings::FPSCap);
+		}
+		else
+		{
+			RFU_LOG(Info, Attach, "[%p] Using MemoryWrite mode\n", memory->GetTag());
+			if (use_flags_file || IsTargetFpsFlagActive()) WriteFlagsFile(-1);
+			use_flags_file = false;
+
+			// attached in FlagsFile mode without ever looking for the frame delay
+			if (state == AttachState::Attached && !fd_ptr)
+			{
+				state = AttachState::Scan;
+				next_step = std::chrono::steady_clock::now();
+			}
+		}
+	}
+};
\ No newline at end of file
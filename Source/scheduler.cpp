@@ -0,0 +1,105 @@
+#include "scheduler.h"
+
+void Scheduler::DropStale()
+{
+	while (!heap.empty())
+	{
+		auto it = live.find(heap.top().key);
+		if (it != live.end() && it->second == heap.top().sequence)
+			break;
+
+		heap.pop();
+	}
+}
+
+void Scheduler::Schedule(Key key, Clock::time_point deadline)
+{
+	bool earliest;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		DropStale();
+		earliest = heap.empty() || deadline < heap.top().deadline;
+
+		const uint64_t sequence = next_sequence++;
+		live[key] = sequence;
+		heap.push({ deadline, key, sequence });
+
+		// rescheduling leaves stale items behind; rebuild once they outnumber the live ones
+		if (heap.size() > 2 * live.size() + 16)
+		{
+			std::priority_queue<Item, std::vector<Item>, std::greater<Item>> compacted;
+			for (; !heap.empty(); heap.pop())
+			{
+				auto it = live.find(heap.top().key);
+				if (it != live.end() && it->second == heap.top().sequence)
+					compacted.push(heap.top());
+			}
+
+			heap.swap(compacted);
+		}
+	}
+
+	if (earliest)
+		changed.notify_all();
+}
+
+void Scheduler::Cancel(Key key)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	live.erase(key);
+}
+
+void Scheduler::Wake()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		woken = true;
+	}
+
+	changed.notify_all();
+}
+
+bool Scheduler::WaitUntilDue(std::vector<Key> &due, Clock::time_point limit)
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	while (true)
+	{
+		DropStale();
+
+		const auto now = Clock::now();
+		if (woken || now >= limit || (!heap.empty() && heap.top().deadline <= now))
+			break;
+
+		const auto deadline = heap.empty() || limit < heap.top().deadline ? limit : heap.top().deadline;
+		changed.wait_until(guard, deadline);
+	}
+
+	const auto now = Clock::now();
+	for (DropStale(); !heap.empty() && heap.top().deadline <= now; DropStale())
+	{
+		due.push_back(heap.top().key);
+		live.erase(heap.top().key);
+		heap.pop();
+	}
+
+	const bool was_woken = woken;
+	woken = false;
+	return was_woken;
+}
+
+Scheduler::Clock::time_point Scheduler::GetNextDeadline()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	DropStale();
+	return heap.empty() ? Clock::time_point::max() : heap.top().deadline;
+}
+
+size_t Scheduler::GetCount()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return live.size();
+}
\ No newline at end of file
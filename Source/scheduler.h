@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Min-heap of per-key deadlines for a single waiting thread. Rescheduling a key replaces its previous deadline (the old heap
+// item is skipped when it surfaces), so each key is due at most once.
+class Scheduler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using Key = uint64_t;
+
+	// Thread-safe; wakes the waiting thread if this becomes the earliest deadline
+	void Schedule(Key key, Clock::time_point deadline);
+	void Cancel(Key key);
+
+	// Thread-safe; makes WaitUntilDue return right away (e.g. a UI change or a process exit)
+	void Wake();
+
+	// Sleeps until the earliest deadline, `limit` or Wake(), whichever is first, then moves every key that is due to `due`.
+	// Returns true if it was woken by Wake().
+	bool WaitUntilDue(std::vector<Key> &due, Clock::time_point limit);
+
+	Clock::time_point GetNextDeadline();
+	size_t GetCount();
+
+private:
+	struct Item
+	{
+		Clock::time_point deadline;
+		Key key;
+		uint64_t sequence;
+
+		bool operator>(const Item &other) const { return deadline > other.deadline; }
+	};
+
+	void DropStale(); // pops items that were rescheduled or cancelled off the top
+
+	std::mutex lock;
+	std::condition_variable changed;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+	std::unordered_map<Key, uint64_t> live; // sequence of each key's current item
+	uint64_t next_sequence = 0;
+	bool woken = false;
+};
\ No newline at end of file
@@ -6,6 +6,12 @@
 #include <fstream>
 #include <functional>
 #include <cerrno>
+#include <cmath>
+
+#ifndef _WIN32
+#include <strings.h>
+#define _stricmp strcasecmp
+#endif
 
 // todo: jesus this is ugly rewrite all this if i ever care enough
 
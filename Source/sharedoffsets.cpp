@@ -0,0 +1,101 @@
+#include "sharedoffsets.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	struct State
+	{
+		SharedOffsets::Build build;
+		bool resolved = false;
+		bool in_flight = false;
+	};
+
+	std::mutex lock;
+	std::unordered_map<std::string, State> builds;
+	std::function<void()> listener;
+
+	void NotifyListener()
+	{
+		std::function<void()> callback;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			callback = listener;
+		}
+
+		if (callback)
+			callback();
+	}
+}
+
+SharedOffsets::AcquireResult SharedOffsets::Acquire(const OffsetCache::Fingerprint &fingerprint, Build &out)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	auto &state = builds[fingerprint.ToString()];
+
+	if (state.in_flight)
+		return AcquireResult::Pending;
+
+	if (state.resolved)
+	{
+		out = state.build;
+		return AcquireResult::Resolved;
+	}
+
+	state.in_flight = true;
+	return AcquireResult::Owner;
+}
+
+void SharedOffsets::Publish(const OffsetCache::Fingerprint &fingerprint, const Build &build)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto &state = builds[fingerprint.ToString()];
+
+		const bool had_frame_delay = state.build.has_frame_delay;
+		const uint32_t frame_delay_offset = state.build.frame_delay_offset;
+
+		state.build = build;
+		if (!build.has_frame_delay && had_frame_delay)
+		{
+			state.build.has_frame_delay = true;
+			state.build.frame_delay_offset = frame_delay_offset;
+		}
+
+		state.resolved = !state.build.ts_ptr_rvas.empty();
+		state.in_flight = false;
+	}
+
+	NotifyListener();
+}
+
+void SharedOffsets::Release(const OffsetCache::Fingerprint &fingerprint)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		builds[fingerprint.ToString()].in_flight = false;
+	}
+
+	NotifyListener();
+}
+
+bool SharedOffsets::Lookup(const OffsetCache::Fingerprint &fingerprint, Build &out)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	auto it = builds.find(fingerprint.ToString());
+	if (it == builds.end() || !it->second.resolved)
+		return false;
+
+	out = it->second.build;
+	return true;
+}
+
+void SharedOffsets::SetListener(std::function<void()> callback)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	listener = std::move(callback);
+}
\ No newline at end of file
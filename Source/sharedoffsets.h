@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+
+#include "offsetcache.h"
+
+// In-memory registry of what each client build resolved to, shared by every RobloxProcess in this instance of the unlocker.
+// Same-build clients have the same module layout, so whatever one of them found only needs rebasing to the next one's base.
+namespace SharedOffsets
+{
+	struct Build
+	{
+		std::vector<uint32_t> ts_ptr_rvas; // TaskScheduler pointer candidates
+		uint32_t frame_delay_offset = 0;
+		bool has_frame_delay = false;
+	};
+
+	enum class AcquireResult
+	{
+		Resolved, // `out` holds what another process of this build found
+		Owner, // nothing known yet: the caller scans, then calls Publish or Release
+		Pending // another process is scanning this build right now; try again once it published or released (see SetListener)
+	};
+
+	// Never blocks, so a process waiting on another one's scan doesn't hold up a pool thread
+	AcquireResult Acquire(const OffsetCache::Fingerprint &fingerprint, Build &out);
+
+	// Merges `build` into what's known (keeping a known frame delay offset) and releases ownership if held
+	void Publish(const OffsetCache::Fingerprint &fingerprint, const Build &build);
+	void Release(const OffsetCache::Fingerprint &fingerprint);
+
+	// Called after every Publish and Release, on the calling thread with no lock held, so Pending callers can be stepped again
+	// right away. There is one listener; an empty function removes it.
+	void SetListener(std::function<void()> listener);
+
+	bool Lookup(const OffsetCache::Fingerprint &fingerprint, Build &out);
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "signatures.h"
+#include "log.h"
+#include "phasestats.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <unordered_set>
+
+namespace
+{
+	bool FindTaskScheduler64(ImageView &image, const void *tag, std::vector<const void *> &out, const char *&variant)
+	{
+		const auto code = image.GetCodeRange();
+		const auto start = code.first;
+		const auto end = code.second;
+
+		// 40 53 48 83 EC 20 0F B6 D9 E8 ?? ?? ?? ?? 86 58 04 48 83 C4 20 5B C3
+		PhaseStats::Timer scan_timer(PhaseStats::Phase::SignatureScan);
+		Trace::Span scan_span("sig studio", "signature");
+		auto result = (const uint8_t *)image.Scan("\x40\x53\x48\x83\xEC\x20\x0F\xB6\xD9\xE8\x00\x00\x00\x00\x86\x58\x04\x48\x83\xC4\x20\x5B\xC3", "xxxxxxxxxx????xxxxxxxxx", start, end);
+		scan_timer.Stop();
+		scan_span.Stop();
+
+		if (result)
+		{
+			PhaseStats::Timer resolve_timer(PhaseStats::Phase::Rel32Resolve);
+
+			int32_t rel32;
+			if (!image.Read(result + 10, rel32))
+				return false;
+
+			auto gts_fn = result + 14 + rel32;
+
+			RFU_LOG(Info, Scan, "[%p] GetTaskScheduler (sig studio): %p\n", tag, gts_fn);
+			Trace::Instant("SignatureHit", "signature", Trace::Address("function", gts_fn));
+
+			if (auto buffer = image.Get(gts_fn, 0x100))
+			{
+				if (auto inst = sigscan::scan("\x48\x8B\x05\x00\x00\x00\x00\x48\x83\xC4\x28", "xxx????xxxx", (uintptr_t)buffer, (uintptr_t)buffer + 0x100)) // mov eax, <TaskSchedulerPtr>; mov ecx, [ebp-0Ch])
+				{
+					const uint8_t *remote = gts_fn + (inst - buffer);
+					out = { remote + 7 + *(int32_t *)(inst + 3) };
+					variant = "studio";
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// Assume Byfron
+		// 
+		// Thought process: Fancy new anti-cheat technology makes inspecting .text a bit more troublesome than before
+		// As a result, I've opted to sig GetTaskScheduler directly instead of looking for one its callers.
+		// A longer, uglier signature could be used to produce a single result here,
+		// but for the sake of (hopefully) increased reliability, we'll use a simple signature that returns about 8 candidates in a loaded game.
+
+		std::unordered_set<const void *> candidates{};
+		auto stop = (std::min)(end, start + 40 * 1024 * 1024); // optim: keep search roughly within .text
+		const size_t candidate_threshold = 5;
+
+		// 48 8B 05 ?? ?? ?? ?? 48 83 C4 48 C3
+		PhaseStats::Timer byfron_timer(PhaseStats::Phase::SignatureScan); // includes resolving each hit's rel32
+		Trace::Span byfron_span("sig byfron", "signature");
+		image.ScanAll("\x48\x8B\x05\x00\x00\x00\x00\x48\x83\xC4\x48\xC3", "xxx????xxxxx", [&](const uint8_t *result, const uint8_t *local) // mov rax, <Rel32>; add rsp, 48h; retn
+		{
+			candidates.insert(result + 7 + *(int32_t *)(local + 3));
+			return candidates.size() < candidate_threshold;
+		}, start, stop);
+		byfron_timer.Stop();
+		byfron_span.Stop();
+
+		RFU_LOG(Info, Scan, "[%p] GetTaskScheduler (sig byfron): found %zu candidates\n", tag, candidates.size());
+
+		if (candidates.size() != candidate_threshold)
+			return false; // keep looking
+
+		out = std::vector<const void *>(candidates.begin(), candidates.end());
+		variant = "byfron";
+		return true;
+	}
+
+	bool FindTaskScheduler32(ImageView &image, const void *tag, std::vector<const void *> &out, const char *&variant)
+	{
+		const auto code = image.GetCodeRange();
+
+		// The 32-bit signatures are matched in a single pass over the module; when several hit, the earliest entry wins
+		struct Signature
+		{
+			const char *name;
+			const char *aob;
+			const char *mask;
+			size_t rel32_offset; // operand of the call to GetTaskScheduler
+		};
+
+		static const Signature signatures[] = {
+			// 55 8B EC 83 E4 F8 83 EC 08 E8 ?? ?? ?? ?? 8D 0C 24
+			{ "ltcg", "\x55\x8B\xEC\x83\xE4\xF8\x83\xEC\x08\xE8\xDE\xAD\xBE\xEF\x8D\x0C\x24", "xxxxxxxxxx????xxx", 10 },
+			// 55 8B EC 83 EC 10 56 E8 ?? ?? ?? ?? 8B F0 8D 45 F0
+			{ "non-ltcg", "\x55\x8B\xEC\x83\xEC\x10\x56\xE8\x00\x00\x00\x00\x8B\xF0\x8D\x45\xF0", "xxxxxxxx????xxxxx", 8 },
+			// 55 8B EC 83 E4 F8 83 EC 14 56 E8 ?? ?? ?? ?? 8D 4C 24 10
+			{ "uwp", "\x55\x8B\xEC\x83\xE4\xF8\x83\xEC\x14\x56\xE8\x00\x00\x00\x00\x8D\x4C\x24\x10", "xxxxxxxxxxx????xxxx", 11 },
+		};
+
+		sigscan::pattern_set patterns;
+		for (const auto &signature : signatures) patterns.add(signature.aob, signature.mask);
+
+		const uint8_t *hits[std::size(signatures)]{};
+		PhaseStats::Timer scan_timer(PhaseStats::Phase::SignatureScan);
+		Trace::Span scan_span("sig set (32-bit)", "signature");
+		image.Scan(patterns, [&](size_t id, uint8_t *location)
+		{
+			Trace::Instant("SignatureHit", "signature", Trace::Value("id", id), Trace::Address("address", location));
+			if (!hits[id]) hits[id] = location;
+			return hits[0] == nullptr; // nothing outranks the first signature
+		}, code.first, code.second);
+		scan_timer.Stop();
+		scan_span.Stop();
+
+		for (size_t id = 0; id < std::size(signatures); id++)
+		{
+			if (!hits[id]) continue;
+
+			const auto &signature = signatures[id];
+			PhaseStats::Timer resolve_timer(PhaseStats::Phase::Rel32Resolve);
+
+			int32_t rel32;
+			if (!image.Read(hits[id] + signature.rel32_offset, rel32))
+				return false;
+
+			auto gts_fn = hits[id] + signature.rel32_offset + 4 + rel32;
+
+			RFU_LOG(Info, Scan, "[%p] GetTaskScheduler (sig %s): %p\n", tag, signature.name, gts_fn);
+
+			if (auto buffer = image.Get(gts_fn, 0x100))
+			{
+				if (auto inst = sigscan::scan("\xA1\x00\x00\x00\x00\x8B\x4D\xF4", "x????xxx", (uintptr_t)buffer, (uintptr_t)buffer + 0x100)) // mov eax, <TaskSchedulerPtr>; mov ecx, [ebp-0Ch])
+				{
+					//printf("[%p] Inst: %p\n", process, gts_fn + (inst - buffer));
+					// absolute operand: relocated in a live image, still relative to the preferred base in a file
+					out = { (const void *)(uintptr_t)(*(uint32_t *)(inst + 1) + image.GetRelocationDelta()) };
+					variant = signature.name;
+					return true;
+				}
+			}
+
+			break; // like before, lower priority signatures aren't tried when a better one hits
+		}
+
+		return false;
+	}
+}
+
+bool Signatures::FindTaskSchedulerPointers(ImageView &image, bool is_64bit, const void *tag, std::vector<const void *> &out, const char **variant)
+{
+	const char *found = nullptr;
+	const bool result = is_64bit ? FindTaskScheduler64(image, tag, out, found) : FindTaskScheduler32(image, tag, out, found);
+	if (result && variant) *variant = found;
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+#include "imageview.h"
+
+namespace Signatures
+{
+	// Finds the TaskScheduler pointer (or a handful of candidates on Byfron clients) in a Roblox image.
+	// `tag` only prefixes the log lines. Returns false if nothing usable was found.
+	// `variant`, if given, receives the name of the signature that hit ("studio", "byfron", "ltcg", ...).
+	bool FindTaskSchedulerPointers(ImageView &image, bool is_64bit, const void *tag, std::vector<const void *> &out, const char **variant = nullptr);
+}
\ No newline at end of file
@@ -1,11 +1,277 @@
 #include "sigscan.h"
 
+#include <cstring>
+
+#ifdef _WIN32
 #include <Windows.h>
 #include <Psapi.h>
 #pragma comment(lib, "Psapi.lib")
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIGSCAN_X86
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIGSCAN_X64
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SIGSCAN_TARGET(x)
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#define SIGSCAN_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
 
 namespace sigscan
 {
+	namespace
+	{
+		// Rough rank of how often a byte shows up in x86 code (higher = more common). Unlisted bytes are treated as rare.
+		// Anchoring on rare bytes keeps the number of false candidates (and full compares) low.
+		int anchor_weight(uint8_t value)
+		{
+			switch (value)
+			{
+			case 0x00: return 100;
+			case 0xCC: case 0xFF: return 90;
+			case 0x48: case 0x8B: return 80;
+			case 0x89: case 0x24: case 0x4C: case 0x0F: return 70;
+			case 0x83: case 0xE8: case 0x8D: case 0x44: case 0x85: case 0x01: return 60;
+			case 0x45: case 0x74: case 0x75: case 0xC3: case 0x41: case 0x49: case 0x40: case 0x08: case 0x10: case 0x20: return 50;
+			case 0x04: case 0xC0: case 0xC4: case 0x28: case 0x30: case 0x38: case 0xEB: case 0x33: case 0xE9: case 0x02: return 40;
+			default: return 0;
+			}
+		}
+
+#ifdef SIGSCAN_X86
+		void cpuid(int leaf, int subleaf, int regs[4])
+		{
+#ifdef _MSC_VER
+			__cpuidex(regs, leaf, subleaf);
+#else
+			unsigned int a = 0, b = 0, c = 0, d = 0;
+			__cpuid_count(leaf, subleaf, a, b, c, d);
+			regs[0] = (int)a; regs[1] = (int)b; regs[2] = (int)c; regs[3] = (int)d;
+#endif
+		}
+
+		uint64_t xgetbv0()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			uint32_t lo, hi;
+			__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+			return ((uint64_t)hi << 32) | lo;
+#endif
+		}
+
+		isa query_isa()
+		{
+			int regs[4]{};
+			cpuid(0, 0, regs);
+			const int max_leaf = regs[0];
+
+			cpuid(1, 0, regs);
+			const bool sse2 = (regs[3] & (1 << 26)) != 0;
+			const bool osxsave = (regs[2] & (1 << 27)) != 0;
+			const bool avx = (regs[2] & (1 << 28)) != 0;
+
+			if (!sse2)
+				return isa::scalar;
+
+			if (!osxsave || !avx || max_leaf < 7)
+				return isa::sse2;
+
+			const uint64_t xcr0 = xgetbv0();
+			if ((xcr0 & 0x6) != 0x6) // xmm/ymm state
+				return isa::sse2;
+
+			cpuid(7, 0, regs);
+			const bool avx2 = (regs[1] & (1 << 5)) != 0;
+			const bool avx512f = (regs[1] & (1 << 16)) != 0;
+			const bool avx512bw = (regs[1] & (1 << 30)) != 0;
+
+#ifdef SIGSCAN_X64
+			if (avx512f && avx512bw && (xcr0 & 0xE0) == 0xE0) // opmask/zmm state
+				return isa::avx512;
+#endif
+
+			return avx2 ? isa::avx2 : isa::sse2;
+		}
+
+		inline unsigned int lowest_bit(uint32_t bits)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, bits);
+			return index;
+#else
+			return __builtin_ctz(bits);
+#endif
+		}
+
+		// Each SIMD scanner checks the anchor bytes for [position, position + width) in one go and only runs the full compare on candidates.
+		// Candidates are visited in ascending order so the first hit is the same one the scalar loop would return.
+		// Callers guarantee `start + width <= limit` holds for every iteration they want vectorized; the remainder is returned for the scalar tail.
+
+		SIGSCAN_TARGET("sse2")
+		const uint8_t *scan_sse2(const pattern &p, const uint8_t *&start, const uint8_t *limit)
+		{
+			const __m128i first = _mm_set1_epi8((char)p.anchor_value[0]);
+			const __m128i second = _mm_set1_epi8((char)p.anchor_value[1]);
+
+			for (; start + 16 <= limit; start += 16)
+			{
+				__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(start + p.anchor_offset[0])), first);
+				if (p.anchor_count > 1) eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(start + p.anchor_offset[1])), second));
+
+				for (uint32_t bits = (uint32_t)_mm_movemask_epi8(eq); bits; bits &= bits - 1)
+				{
+					const uint8_t *candidate = start + lowest_bit(bits);
+					if (compare((const char *)candidate, p.aob, p.mask)) return candidate;
+				}
+			}
+
+			return nullptr;
+		}
+
+		SIGSCAN_TARGET("avx2")
+		const uint8_t *scan_avx2(const pattern &p, const uint8_t *&start, const uint8_t *limit)
+		{
+			const __m256i first = _mm256_set1_epi8((char)p.anchor_value[0]);
+			const __m256i second = _mm256_set1_epi8((char)p.anchor_value[1]);
+
+			for (; start + 32 <= limit; start += 32)
+			{
+				__m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(start + p.anchor_offset[0])), first);
+				if (p.anchor_count > 1) eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(start + p.anchor_offset[1])), second));
+
+				for (uint32_t bits = (uint32_t)_mm256_movemask_epi8(eq); bits; bits &= bits - 1)
+				{
+					const uint8_t *candidate = start + lowest_bit(bits);
+					if (compare((const char *)candidate, p.aob, p.mask)) return candidate;
+				}
+			}
+
+			return nullptr;
+		}
+
+#ifdef SIGSCAN_X64
+		SIGSCAN_TARGET("avx512f,avx512bw")
+		const uint8_t *scan_avx512(const pattern &p, const uint8_t *&start, const uint8_t *limit)
+		{
+			const __m512i first = _mm512_set1_epi8((char)p.anchor_value[0]);
+			const __m512i second = _mm512_set1_epi8((char)p.anchor_value[1]);
+
+			for (; start + 64 <= limit; start += 64)
+			{
+				uint64_t bits = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void *)(start + p.anchor_offset[0])), first);
+				if (p.anchor_count > 1) bits &= _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void *)(start + p.anchor_offset[1])), second);
+
+				for (; bits; bits &= bits - 1)
+				{
+#ifdef _MSC_VER
+					unsigned long index;
+					_BitScanForward64(&index, bits);
+#else
+					const unsigned int index = __builtin_ctzll(bits);
+#endif
+					const uint8_t *candidate = start + index;
+					if (compare((const char *)candidate, p.aob, p.mask)) return candidate;
+				}
+			}
+
+			return nullptr;
+		}
+#endif
+#endif
+
+		// Searches the positions [position, limit); the caller guarantees that a full pattern fits at every one of them
+		const uint8_t *find(const pattern &pattern, const uint8_t *position, const uint8_t *limit)
+		{
+			if (pattern.method == strategy::horspool)
+			{
+				const uint8_t key = (uint8_t)pattern.aob[pattern.last_fixed];
+
+				while (position < limit)
+				{
+					const uint8_t value = position[pattern.last_fixed];
+					if (value == key && compare((const char *)position, pattern.aob, pattern.mask))
+						return position;
+
+					position += pattern.shift[value];
+				}
+
+				return nullptr;
+			}
+
+#ifdef SIGSCAN_X86
+			if (pattern.method == strategy::simd)
+			{
+				const uint8_t *result = nullptr;
+
+				switch (pattern.simd_isa)
+				{
+#ifdef SIGSCAN_X64
+				case isa::avx512: result = scan_avx512(pattern, position, limit); break;
+#endif
+				case isa::avx2: result = scan_avx2(pattern, position, limit); break;
+				case isa::sse2: result = scan_sse2(pattern, position, limit); break;
+				default: break;
+				}
+
+				if (result) return result;
+			}
+#endif
+
+			for (; position < limit; ++position)
+			{
+				if (compare((const char *)position, pattern.aob, pattern.mask))
+				{
+					return position;
+				}
+			}
+
+			return nullptr;
+		}
+	}
+
+	isa detect_isa()
+	{
+#ifdef SIGSCAN_X86
+		static const isa result = query_isa();
+		return result;
+#else
+		return isa::scalar;
+#endif
+	}
+
+	strategy default_strategy = strategy::automatic;
+
+	const char *isa_name(isa value)
+	{
+		switch (value)
+		{
+		case isa::sse2: return "sse2";
+		case isa::avx2: return "avx2";
+		case isa::avx512: return "avx512";
+		default: return "scalar";
+		}
+	}
+
+	const char *strategy_name(strategy value)
+	{
+		switch (value)
+		{
+		case strategy::scalar: return "scalar";
+		case strategy::simd: return isa_name(detect_isa());
+		case strategy::horspool: return "horspool";
+		default: return "automatic";
+		}
+	}
+
 	bool compare(const char *location, const char *aob, const char *mask)
 	{
 		for (; *mask; ++aob, ++mask, ++location)
@@ -33,17 +299,318 @@ namespace sigscan
 		return true;
 	}
 
-	uint8_t *scan(const char *aob, const char *mask, uintptr_t start, uintptr_t end)
+	pattern::pattern(const char *aob, const char *mask, strategy preferred)
+		: aob(aob), mask(mask), length(strlen(mask)), method(preferred)
 	{
-		if (start <= end)
+		// anchors: the one or two rarest fixed bytes
+		for (size_t i = 0; i < length; i++)
 		{
-			for (; start < end - strlen(mask); ++start)
+			if (mask[i] != 'x') continue;
+
+			const int weight = anchor_weight((uint8_t)aob[i]);
+
+			if (anchor_count == 0 || weight < anchor_weight(anchor_value[0]))
 			{
-				if (compare((char *)start, (char *)aob, mask))
+				anchor_offset[1] = anchor_offset[0];
+				anchor_value[1] = anchor_value[0];
+				anchor_offset[0] = i;
+				anchor_value[0] = (uint8_t)aob[i];
+				anchor_count = anchor_count == 0 ? 1 : 2;
+			}
+			else if (anchor_count == 1 || weight < anchor_weight(anchor_value[1]))
+			{
+				anchor_offset[1] = i;
+				anchor_value[1] = (uint8_t)aob[i];
+				anchor_count = 2;
+			}
+
+			last_fixed = i;
+		}
+
+		// skip table: a wildcard matches every byte, so the shift is capped by the distance to the closest wildcard before last_fixed
+		size_t tail_start = 0;
+		for (size_t i = last_fixed; i > 0; i--)
+		{
+			if (mask[i - 1] != 'x')
+			{
+				tail_start = i;
+				break;
+			}
+		}
+
+		const uint32_t max_shift = (uint32_t)(last_fixed - tail_start + 1);
+		for (uint32_t &value : shift) value = max_shift;
+		for (size_t i = tail_start; i < last_fixed; i++) shift[(uint8_t)aob[i]] = (uint32_t)(last_fixed - i);
+
+		if (method == strategy::automatic) method = default_strategy;
+		if (method == strategy::automatic)
+		{
+			// prefer whichever advances further per step: a vector of anchor compares or the best-case skip
+			size_t simd_width = 0;
+			switch (detect_isa())
+			{
+			case isa::sse2: simd_width = 16; break;
+			case isa::avx2: simd_width = 32; break;
+			case isa::avx512: simd_width = 64; break;
+			default: break;
+			}
+
+			if (anchor_count == 0)
+				method = strategy::scalar;
+			else if (max_shift > simd_width && max_shift >= 4)
+				method = strategy::horspool;
+			else if (simd_width > 0)
+				method = strategy::simd;
+			else
+				method = strategy::scalar;
+		}
+
+		if (anchor_count == 0) method = strategy::scalar;
+		if (method == strategy::simd && detect_isa() == isa::scalar) method = strategy::scalar;
+	}
+
+	uint8_t *scan(const pattern &pattern, uintptr_t start, uintptr_t end)
+	{
+		if (start > end)
+			return scan(pattern.aob, pattern.mask, start, end);
+
+		if (end - start <= pattern.length)
+			return 0;
+
+		// Valid positions are [start, end - length), matching the bounds of the original scalar loop
+		return (uint8_t *)find(pattern, (const uint8_t *)start, (const uint8_t *)(end - pattern.length));
+	}
+
+	bool scan_all(const pattern &pattern, uintptr_t start, uintptr_t end, const std::function<bool(uint8_t *location)> &callback)
+	{
+		while (uint8_t *location = scan(pattern, start, end))
+		{
+			if (!callback(location))
+				return false;
+
+			start = (uintptr_t)location + 1;
+		}
+
+		return true;
+	}
+
+	size_t pattern_set::add(const char *aob, const char *mask)
+	{
+		patterns.emplace_back(aob, mask);
+		const pattern &added = patterns.back();
+
+		// key: longest run of fixed bytes
+		size_t best_offset = 0, best_length = 0;
+		for (size_t i = 0; i < added.length;)
+		{
+			if (mask[i] != 'x')
+			{
+				i++;
+				continue;
+			}
+
+			size_t run = i;
+			while (run < added.length && mask[run] == 'x') run++;
+
+			if (run - i > best_length)
+			{
+				best_offset = i;
+				best_length = run - i;
+			}
+
+			i = run;
+		}
+
+		key_offset.push_back(best_offset);
+		key_length.push_back(best_length);
+		if (added.length > longest) longest = added.length;
+
+		build();
+		return patterns.size() - 1;
+	}
+
+	void pattern_set::build()
+	{
+		states.assign(1, state{});
+
+		// trie (0 doubles as "no edge" here since nothing points back to the root yet)
+		for (size_t id = 0; id < patterns.size(); id++)
+		{
+			if (key_length[id] == 0) continue; // all wildcards, never reported
+
+			uint32_t current = 0;
+			for (size_t i = 0; i < key_length[id]; i++)
+			{
+				const uint8_t value = (uint8_t)patterns[id].aob[key_offset[id] + i];
+				if (!states[current].next[value])
 				{
-					return (uint8_t *)start;
+					states[current].next[value] = (uint32_t)states.size();
+					states.push_back(state{});
 				}
+				current = states[current].next[value];
 			}
+
+			states[current].outputs.push_back(id);
+		}
+
+		// failure links, folded into the transition table so scanning is one lookup per byte
+		std::vector<uint32_t> fail(states.size());
+		std::vector<uint32_t> queue;
+		queue.reserve(states.size());
+
+		for (uint32_t value = 0; value < 256; value++)
+		{
+			if (uint32_t child = states[0].next[value])
+				queue.push_back(child);
+		}
+
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			const uint32_t current = queue[i];
+			const auto &inherited = states[fail[current]].outputs;
+			states[current].outputs.insert(states[current].outputs.end(), inherited.begin(), inherited.end());
+
+			for (uint32_t value = 0; value < 256; value++)
+			{
+				if (uint32_t child = states[current].next[value])
+				{
+					fail[child] = states[fail[current]].next[value];
+					queue.push_back(child);
+				}
+				else
+				{
+					states[current].next[value] = states[fail[current]].next[value];
+				}
+			}
+		}
+	}
+
+	bool pattern_set::scan(uintptr_t start, uintptr_t end, const callback &callback) const
+	{
+		uint32_t current = 0;
+
+		for (const uint8_t *position = (const uint8_t *)start; position < (const uint8_t *)end; ++position)
+		{
+			current = states[current].next[*position];
+
+			for (size_t id : states[current].outputs)
+			{
+				const size_t key_end = key_offset[id] + key_length[id];
+				if ((uintptr_t)position + 1 - start < key_end)
+					continue; // pattern would start before the scanned range
+
+				const uint8_t *location = position + 1 - key_end;
+				if (end - (uintptr_t)location < patterns[id].length)
+					continue; // runs past the end
+
+				if (compare((const char *)location, patterns[id].aob, patterns[id].mask) && !callback(id, (uint8_t *)location))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	stream_scanner::stream_scanner(const pattern &pattern, callback callback)
+		: single(&pattern), on_match(std::move(callback)), longest(pattern.length)
+	{
+	}
+
+	stream_scanner::stream_scanner(const pattern_set &patterns, callback callback)
+		: patterns(&patterns), on_match(std::move(callback)), longest(patterns.max_length())
+	{
+	}
+
+	void stream_scanner::reset()
+	{
+		carry.clear();
+		stopped = false;
+	}
+
+	// Reports the matches in data[0, size). When `tail` > 0, data starts with that many carried-over bytes and only matches that start
+	// inside them and end past them are new (anything ending inside the tail was reported by an earlier feed).
+	bool stream_scanner::report(const uint8_t *data, size_t size, uintptr_t address, size_t tail)
+	{
+		auto accept = [&](size_t id, const uint8_t *location, size_t length)
+		{
+			const size_t offset = location - data;
+			if (tail > 0 && (offset >= tail || offset + length <= tail))
+				return true;
+
+			return on_match(id, address + offset, location);
+		};
+
+		if (single)
+		{
+			if (size < single->length)
+				return true;
+
+			const uint8_t *limit = data + size - single->length + 1;
+			for (const uint8_t *position = data; (position = find(*single, position, limit)); ++position)
+			{
+				if (!accept(0, position, single->length))
+					return false;
+			}
+
+			return true;
+		}
+
+		return patterns->scan((uintptr_t)data, (uintptr_t)data + size, [&](size_t id, uint8_t *location)
+		{
+			return accept(id, location, patterns->get(id).length);
+		});
+	}
+
+	bool stream_scanner::feed(const uint8_t *data, size_t size, uintptr_t address)
+	{
+		if (address != next_address)
+			carry.clear();
+
+		next_address = address + size;
+
+		if (stopped || longest == 0)
+			return !stopped;
+
+		// matches starting in the carried tail can only end within the first (longest - 1) bytes of this piece
+		if (!carry.empty())
+		{
+			const size_t head = size < longest - 1 ? size : longest - 1;
+			stitch.assign(carry.begin(), carry.end());
+			stitch.insert(stitch.end(), data, data + head);
+
+			if (!report(stitch.data(), stitch.size(), address - carry.size(), carry.size()))
+			{
+				stopped = true;
+				return false;
+			}
+		}
+
+		if (!report(data, size, address, 0))
+		{
+			stopped = true;
+			return false;
+		}
+
+		// keep the last (longest - 1) bytes of the stream
+		const size_t keep = longest - 1;
+		if (size >= keep)
+		{
+			carry.assign(data + size - keep, data + size);
+		}
+		else
+		{
+			carry.insert(carry.end(), data, data + size);
+			if (carry.size() > keep) carry.erase(carry.begin(), carry.end() - keep);
+		}
+
+		return true;
+	}
+
+	uint8_t *scan(const char *aob, const char *mask, uintptr_t start, uintptr_t end)
+	{
+		if (start <= end)
+		{
+			return scan(pattern(aob, mask), start, end);
 		}
 		else
 		{
@@ -59,6 +626,7 @@ namespace sigscan
 		return 0;
 	};
 
+#ifdef _WIN32
 	uint8_t *scan(const char *module, const char *aob, const char *mask)
 	{
 		MODULEINFO info;
@@ -67,4 +635,5 @@ namespace sigscan
 
 		return 0;
 	}
+#endif
 }
\ No newline at end of file
@@ -1,11 +1,120 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <vector>
 
 namespace sigscan
 {
+	enum class isa
+	{
+		scalar,
+		sse2,
+		avx2,
+		avx512
+	};
+
+	enum class strategy
+	{
+		automatic,
+		scalar,   // compare at every offset
+		simd,     // anchor bytes tested 16-64 offsets at a time (see detect_isa)
+		horspool  // bad-character skip table built from the wildcard-free tail of the pattern
+	};
+
+	isa detect_isa(); // best instruction set supported by both the cpu and the os (cached after the first call)
+	const char *isa_name(isa value);
+	const char *strategy_name(strategy value);
+
+	extern strategy default_strategy; // used by patterns created with strategy::automatic, useful for comparing strategies
+
+	// Pattern compiled once and reused across scans. aob and mask must outlive it.
+	struct pattern
+	{
+		const char *aob;
+		const char *mask;
+		size_t length;
+		strategy method;
+		isa simd_isa = detect_isa(); // what strategy::simd runs on; may be lowered (never raised) to compare implementations
+
+		size_t anchor_count = 0; // 0 (all wildcards), 1 or 2
+		size_t anchor_offset[2]{};
+		uint8_t anchor_value[2]{};
+
+		size_t last_fixed = 0; // index the horspool window is keyed on
+		uint32_t shift[256]{};
+
+		pattern(const char *aob, const char *mask, strategy preferred = strategy::automatic);
+	};
+
+	// Several patterns matched in a single pass. Every pattern is keyed by its longest wildcard-free run, the keys are compiled into
+	// one Aho-Corasick automaton and each key hit is verified against the full masked pattern.
+	class pattern_set
+	{
+	public:
+		using callback = std::function<bool(size_t id, uint8_t *location)>; // return false to stop scanning
+
+		size_t add(const char *aob, const char *mask); // returns the pattern id (ids are assigned in order, starting at 0)
+		size_t size() const { return patterns.size(); }
+		size_t max_length() const { return longest; }
+		const pattern &get(size_t id) const { return patterns[id]; }
+
+		// Reports every match that lies entirely within [start, end), ordered by the end of its key. Returns false if the callback stopped the scan.
+		bool scan(uintptr_t start, uintptr_t end, const callback &callback) const;
+
+	private:
+		struct state
+		{
+			uint32_t next[256];
+			std::vector<size_t> outputs; // ids of patterns whose key ends here
+		};
+
+		void build();
+
+		std::vector<pattern> patterns;
+		std::vector<size_t> key_offset;
+		std::vector<size_t> key_length;
+		std::vector<state> states;
+		size_t longest = 0;
+	};
+
+	// Incremental matcher for data that arrives in pieces (chunks of remote memory, a file, ...). Every match is reported exactly once,
+	// including ones that straddle two pieces, without re-reading anything: only the last (longest pattern - 1) bytes are carried over.
+	class stream_scanner
+	{
+	public:
+		// `data` points at a contiguous copy of the matched bytes and is only valid for the duration of the call. Return false to stop.
+		using callback = std::function<bool(size_t id, uintptr_t address, const uint8_t *data)>;
+
+		stream_scanner(const pattern &pattern, callback callback); // id is always 0
+		stream_scanner(const pattern_set &patterns, callback callback);
+
+		// `address` is where data[0] lives in the scanned address space. Feeding a piece that doesn't continue the previous one starts a
+		// new stream. Returns false once the callback stopped the scan.
+		bool feed(const uint8_t *data, size_t size, uintptr_t address);
+		void reset();
+
+	private:
+		bool report(const uint8_t *data, size_t size, uintptr_t address, size_t tail);
+
+		const pattern *single = nullptr;
+		const pattern_set *patterns = nullptr;
+		callback on_match;
+		size_t longest;
+
+		std::vector<uint8_t> carry; // tail of the stream so far
+		std::vector<uint8_t> stitch; // carry + head of the next piece
+		uintptr_t next_address = 0;
+		bool stopped = false;
+	};
+
 	bool compare(const char *location, const char *aob, const char *mask);
 	bool compare_reverse(const char *location, const char *aob, const char *mask);
+	uint8_t *scan(const pattern &pattern, uintptr_t start, uintptr_t end);
 	uint8_t *scan(const char *aob, const char *mask, uintptr_t start, uintptr_t end);
+	bool scan_all(const pattern &pattern, uintptr_t start, uintptr_t end, const std::function<bool(uint8_t *location)> &callback); // returns false if the callback stopped the scan
+#ifdef _WIN32
 	uint8_t *scan(const char *module, const char *aob, const char *mask);
+#endif
 }
\ No newline at end of file
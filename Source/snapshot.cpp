@@ -0,0 +1,263 @@
+#include "snapshot.h"
+#include "regionmap.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+ProcUtil::ModuleSnapshot::ModuleSnapshot(MemorySource &source, const ModuleInfo &module)
+	: source(source), base((const uint8_t *)module.base), size(module.size)
+{
+	pages.assign((size + PageSize - 1) / PageSize, PageState::Missing);
+	chunks.resize((pages.size() + ChunkPages - 1) / ChunkPages);
+
+	const size_t header_size = size < PE::HeaderReadSize ? size : PE::HeaderReadSize;
+	if (const uint8_t *header = Get(base, header_size))
+	{
+		has_headers = PE::ParseHeaders(header, header_size, headers);
+	}
+}
+
+std::pair<const uint8_t *, const uint8_t *> ProcUtil::ModuleSnapshot::GetCodeRange() const
+{
+	uint32_t start = UINT32_MAX, end = 0;
+
+	if (has_headers)
+	{
+		for (const auto &section : headers.sections)
+		{
+			if (!section.IsCode()) continue;
+
+			const uint32_t extent = section.virtual_size ? section.virtual_size : section.raw_size;
+			if (section.virtual_address < start) start = section.virtual_address;
+			if (section.virtual_address + extent > end) end = section.virtual_address + extent;
+		}
+	}
+
+	if (start >= end || end > size)
+		return { base, base + size };
+
+	return { base + start, base + end };
+}
+
+void ProcUtil::ModuleSnapshot::Fill()
+{
+	const auto range = GetCodeRange();
+	Load((range.first - base) / PageSize, (range.second - base + PageSize - 1) / PageSize);
+}
+
+bool ProcUtil::ModuleSnapshot::Contains(const void *remote, size_t length) const
+{
+	const auto address = (const uint8_t *)remote;
+	return address >= base && address <= base + size && length <= (size_t)(base + size - address);
+}
+
+uint8_t *ProcUtil::ModuleSnapshot::GetLocal(size_t offset)
+{
+	const size_t chunk_size = ChunkPages * PageSize;
+	auto &chunk = chunks[offset / chunk_size];
+
+	// uninitialized on purpose: pages that are never loaded are never touched
+	if (!chunk)
+		chunk.reset(new uint8_t[(std::min)(chunk_size, size - offset / chunk_size * chunk_size)]);
+
+	return chunk.get() + offset % chunk_size;
+}
+
+// Loads every missing page in [first_page, end_page), one read per run of consecutive missing pages
+void ProcUtil::ModuleSnapshot::Load(size_t first_page, size_t end_page)
+{
+	if (end_page > pages.size()) end_page = pages.size();
+
+	size_t page = first_page;
+	while (page < end_page)
+	{
+		if (IsCancelled())
+			return;
+
+		if (pages[page] != PageState::Missing)
+		{
+			page++;
+			continue;
+		}
+
+		const size_t chunk_end = (page / ChunkPages + 1) * ChunkPages;
+		size_t run_end = page + 1;
+		while (run_end < end_page && run_end < chunk_end && pages[run_end] == PageState::Missing) run_end++;
+
+		LoadRun(page, run_end);
+		page = run_end;
+	}
+}
+
+void ProcUtil::ModuleSnapshot::LoadRun(size_t first_page, size_t end_page)
+{
+	const size_t offset = first_page * PageSize;
+	const size_t length = (end_page * PageSize < size ? end_page * PageSize : size) - offset;
+
+	Trace::Span span("ReadRun", "read", Trace::Address("address", base + offset), Trace::Value("size", length));
+
+	stats.syscalls++;
+	if (source.Read(base + offset, GetLocal(offset), length))
+	{
+		stats.bytes_read += length;
+		std::fill(pages.begin() + first_page, pages.begin() + end_page, PageState::Present);
+		return;
+	}
+
+	// part of the run isn't readable (guard pages, no access, ...); fall back to reading region by region
+	const uint8_t *i = base + offset;
+	const uint8_t *end = base + offset + length;
+
+	while (i < end)
+	{
+		MemoryRegion region;
+		if (!source.GetRegions().Find(i, region, &stats.syscalls))
+			break;
+
+		size_t region_size = region.size - (i - region.base);
+		if (i + region_size >= end) region_size = end - i;
+
+		const size_t region_first = (i - base) / PageSize;
+		const size_t region_end = (i - base + region_size + PageSize - 1) / PageSize;
+		PageState state = PageState::Unreadable;
+
+		if (region.readable)
+		{
+			stats.syscalls++;
+			if (source.Read(i, GetLocal(i - base), region_size))
+			{
+				stats.bytes_read += region_size;
+				state = PageState::Present;
+			}
+		}
+
+		std::fill(pages.begin() + region_first, pages.begin() + region_end, state);
+		i += region_size;
+	}
+
+	// anything the walk didn't reach stays unreadable until invalidated
+	for (size_t page = first_page; page < end_page; page++)
+	{
+		if (pages[page] == PageState::Missing)
+			pages[page] = PageState::Unreadable;
+	}
+}
+
+const uint8_t *ProcUtil::ModuleSnapshot::Get(const void *remote, size_t length)
+{
+	if (!Contains(remote, length) || length == 0)
+		return nullptr;
+
+	const size_t offset = (const uint8_t *)remote - base;
+	const size_t first_page = offset / PageSize;
+	const size_t end_page = (offset + length + PageSize - 1) / PageSize;
+
+	Load(first_page, end_page);
+
+	for (size_t page = first_page; page < end_page; page++)
+	{
+		if (pages[page] != PageState::Present)
+			return nullptr;
+	}
+
+	if (first_page / ChunkPages == (end_page - 1) / ChunkPages)
+		return GetLocal(offset);
+
+	const size_t chunk_size = ChunkPages * PageSize;
+	straddle.resize(length);
+
+	for (size_t copied = 0; copied < length;)
+	{
+		const size_t piece = (std::min)(length - copied, chunk_size - (offset + copied) % chunk_size);
+		memcpy(straddle.data() + copied, GetLocal(offset + copied), piece);
+		copied += piece;
+	}
+
+	return straddle.data();
+}
+
+bool ProcUtil::ModuleSnapshot::ClipToModule(const uint8_t *&start, const uint8_t *&end) const
+{
+	if (start < base) start = base;
+	if (end > base + size) end = base + size;
+	return start < end;
+}
+
+// Feeds runs of present pages in [start, end) to the scanner, loading missing pages first
+bool ProcUtil::ModuleSnapshot::Feed(sigscan::stream_scanner &scanner, const uint8_t *start, const uint8_t *end)
+{
+	if (!ClipToModule(start, end))
+		return true;
+
+	const size_t first_page = (start - base) / PageSize;
+	const size_t end_page = (end - base + PageSize - 1) / PageSize;
+	Load(first_page, end_page);
+
+	size_t page = first_page;
+	while (page < end_page)
+	{
+		if (IsCancelled())
+			return false;
+
+		if (pages[page] != PageState::Present)
+		{
+			page++;
+			continue;
+		}
+
+		// the scanner stitches runs that continue each other, so stopping at the end of a chunk doesn't lose matches across it
+		const size_t chunk_end = (page / ChunkPages + 1) * ChunkPages;
+		size_t run_end = page + 1;
+		while (run_end < end_page && run_end < chunk_end && pages[run_end] == PageState::Present) run_end++;
+
+		const uint8_t *run_start = (std::max)(start, base + page * PageSize);
+		const uint8_t *run_stop = (std::min)(end, base + run_end * PageSize);
+
+		Trace::Span span("ScanRun", "scan", Trace::Address("address", run_start), Trace::Value("size", run_stop - run_start));
+		if (!scanner.feed(GetLocal(run_start - base), run_stop - run_start, (uintptr_t)run_start))
+			return false;
+
+		page = run_end;
+	}
+
+	return true;
+}
+
+bool ProcUtil::ModuleSnapshot::ScanAll(const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start, const uint8_t *end)
+{
+	const sigscan::pattern pattern(aob, mask);
+	sigscan::stream_scanner scanner(pattern, [&](size_t, uintptr_t remote, const uint8_t *local)
+	{
+		return callback((const uint8_t *)remote, local);
+	});
+
+	return Feed(scanner, start, end);
+}
+
+bool ProcUtil::ModuleSnapshot::Scan(const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start, const uint8_t *end)
+{
+	sigscan::stream_scanner scanner(patterns, [&](size_t id, uintptr_t remote, const uint8_t *)
+	{
+		return callback(id, (uint8_t *)remote);
+	});
+
+	return Feed(scanner, start, end);
+}
+
+void ProcUtil::ModuleSnapshot::Invalidate(const void *remote, size_t length)
+{
+	const uint8_t *start = (const uint8_t *)remote;
+	const uint8_t *end = start + length;
+	if (!ClipToModule(start, end))
+		return;
+
+	const size_t end_page = (end - base + PageSize - 1) / PageSize;
+	for (size_t page = (start - base) / PageSize; page < end_page; page++)
+		pages[page] = PageState::Missing;
+}
+
+void ProcUtil::ModuleSnapshot::InvalidateAll()
+{
+	std::fill(pages.begin(), pages.end(), PageState::Missing);
+}
\ No newline at end of file
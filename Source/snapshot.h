@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "memorysource.h"
+#include "imageview.h"
+#include "pe.h"
+
+namespace ProcUtil
+{
+	// Local copy of a module's memory shared by every signature scan and code read during one attach.
+	// Pages are copied on first use (or in bulk by Fill) and can be invalidated individually so they're read again next time.
+	// Storage is allocated a chunk at a time as pages are loaded, so only the parts of the module that were read take memory,
+	// and it's kept when pages are invalidated so a retry reuses it.
+	class ModuleSnapshot : public ImageView
+	{
+	public:
+		static const size_t PageSize = 0x1000;
+		static const size_t MaxRunPages = 0x400; // 4 MB per read, so a cancelled attach doesn't have to wait for a whole module
+		static const size_t ChunkPages = MaxRunPages; // a run never spans two chunks
+
+		ModuleSnapshot(MemorySource &source, const ModuleInfo &module);
+
+		ModuleSnapshot(const ModuleSnapshot &) = delete;
+		ModuleSnapshot &operator=(const ModuleSnapshot &) = delete;
+
+		// Copies the code sections (the whole module if the headers couldn't be parsed) using as few reads as possible
+		void Fill();
+
+		// Once `*flag` is set, nothing more is loaded (pages stay missing) and scans stop early
+		void SetCancelFlag(const std::atomic<bool> *flag) { cancel = flag; }
+
+		bool HasHeaders() const { return has_headers; }
+		const PE::Headers &GetHeaders() const { return headers; }
+		std::pair<const uint8_t *, const uint8_t *> GetCodeRange() const override;
+
+		bool Contains(const void *remote, size_t size) const;
+		const uint8_t *Get(const void *remote, size_t size) override; // a range spanning two chunks is copied, and only valid until the next Get
+
+		bool ScanAll(const char *aob, const char *mask, const MatchCallback &callback, const uint8_t *start, const uint8_t *end) override;
+		bool Scan(const sigscan::pattern_set &patterns, const sigscan::pattern_set::callback &callback, const uint8_t *start, const uint8_t *end) override;
+		using ImageView::Scan;
+
+		intptr_t GetRelocationDelta() const override { return 0; }
+
+		void Invalidate(const void *remote, size_t size);
+		void InvalidateAll();
+
+		const ScanStats &GetStats() const { return stats; }
+		void ResetStats() { stats = {}; }
+
+	private:
+		enum class PageState : uint8_t
+		{
+			Missing,
+			Present,
+			Unreadable
+		};
+
+		void Load(size_t first_page, size_t end_page);
+		void LoadRun(size_t first_page, size_t end_page);
+		bool Feed(sigscan::stream_scanner &scanner, const uint8_t *start, const uint8_t *end);
+		bool ClipToModule(const uint8_t *&start, const uint8_t *&end) const;
+		bool IsCancelled() const { return cancel && cancel->load(std::memory_order_relaxed); }
+		uint8_t *GetLocal(size_t offset); // allocates the chunk holding `offset` if needed
+
+		MemorySource &source;
+		const uint8_t *base;
+		size_t size;
+
+		std::vector<std::unique_ptr<uint8_t[]>> chunks; // ChunkPages pages each, the last one shorter
+		std::vector<PageState> pages;
+		std::vector<uint8_t> straddle; // see Get
+
+		PE::Headers headers{};
+		bool has_headers = false;
+
+		ScanStats stats{};
+		const std::atomic<bool> *cancel = nullptr;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "threadpool.h"
+#include "trace.h"
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+	for (size_t i = 0; i < thread_count + 1; i++)
+		queues.push_back(std::make_unique<Queue>());
+
+	for (size_t i = 0; i < thread_count; i++)
+		threads.emplace_back(&ThreadPool::WorkerMain, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(wake_lock);
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for (auto &thread : threads)
+		thread.join();
+
+	// no workers left to drain the queues
+	while (RunOne(0));
+}
+
+size_t ThreadPool::DefaultThreadCount()
+{
+	const size_t hardware = std::thread::hardware_concurrency();
+	return hardware > 1 ? hardware - 1 : 1;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	auto &queue = *queues[next_queue++ % queues.size()];
+
+	{
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(wake_lock);
+		pending++;
+	}
+
+	wake.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t index)> &body)
+{
+	struct State
+	{
+		std::atomic<size_t> remaining;
+		std::mutex lock;
+		std::condition_variable done;
+	};
+
+	if (count == 0)
+		return;
+
+	auto state = std::make_shared<State>();
+	state->remaining = count;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		Submit([state, &body, i]()
+		{
+			body(i);
+
+			std::lock_guard<std::mutex> guard(state->lock);
+			if (--state->remaining == 0)
+				state->done.notify_all();
+		});
+	}
+
+	// help out instead of idling, then wait for stragglers running on workers
+	while (state->remaining > 0)
+	{
+		if (!RunOne(0))
+		{
+			std::unique_lock<std::mutex> guard(state->lock);
+			state->done.wait_for(guard, std::chrono::milliseconds(1), [&] { return state->remaining == 0; });
+		}
+	}
+}
+
+bool ThreadPool::RunOne(size_t home)
+{
+	for (size_t i = 0; i < queues.size(); i++)
+	{
+		auto &queue = *queues[(home + i) % queues.size()];
+		std::function<void()> task;
+
+		{
+			std::lock_guard<std::mutex> guard(queue.lock);
+			if (queue.tasks.empty())
+				continue;
+
+			if (i == 0)
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			else
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(wake_lock);
+			pending--;
+		}
+
+		Trace::Span span("Task", "pool", Trace::Value("stolen", i != 0));
+		task();
+		return true;
+	}
+
+	return false;
+}
+
+void ThreadPool::WorkerMain(size_t index)
+{
+	Trace::SetThreadName("pool worker");
+
+	while (true)
+	{
+		if (RunOne(index))
+			continue;
+
+		std::unique_lock<std::mutex> guard(wake_lock);
+		wake.wait(guard, [this] { return stopping || pending > 0; });
+
+		if (stopping && pending == 0)
+			return;
+	}
+}
\ No newline at end of file
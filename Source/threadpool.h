@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker pops from the front of its own queue and steals from the back of the others' when idle.
+// Tasks must not throw.
+class ThreadPool
+{
+public:
+	// thread_count workers are started; callers of ParallelFor work alongside them, so a pool of 0 threads runs everything on the caller
+	explicit ThreadPool(size_t thread_count = DefaultThreadCount());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	void Submit(std::function<void()> task);
+
+	// Runs body(0) ... body(count - 1) and blocks until all of them returned. Indices are queued in ascending order.
+	void ParallelFor(size_t count, const std::function<void(size_t index)> &body);
+
+	size_t GetThreadCount() const
+	{
+		return threads.size();
+	}
+
+	static size_t DefaultThreadCount(); // hardware threads minus the one calling into the pool
+
+private:
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	bool RunOne(size_t home);
+	void WorkerMain(size_t index);
+
+	std::vector<std::unique_ptr<Queue>> queues; // one per worker, plus a shared one (index 0) for callers outside the pool
+	std::vector<std::thread> threads;
+	std::atomic<size_t> next_queue{ 0 };
+
+	std::mutex wake_lock;
+	std::condition_variable wake;
+	size_t pending = 0; // guarded by wake_lock
+	bool stopping = false;
+};
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include "trace.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> Trace::Enabled{ false };
+
+namespace
+{
+	struct Event
+	{
+		const char *name;
+		const char *category;
+		Trace::Arg args[2];
+		uint64_t start; // microseconds since Start
+		uint64_t duration;
+		uint32_t generation; // the trace it belongs to
+		char phase; // 'X' complete or 'i' instant
+	};
+
+	// Single producer (its thread), single consumer (the flusher)
+	struct ThreadBuffer
+	{
+		static const size_t Capacity = 4096;
+
+		Event events[Capacity];
+		std::atomic<size_t> head{ 0 }; // next event to write
+		std::atomic<size_t> tail{ 0 }; // next event to flush
+		std::atomic<size_t> dropped{ 0 }; // the flusher fell behind
+		std::atomic<bool> retired{ false }; // the thread exited; freed once drained
+		std::atomic<const char *> name{ nullptr };
+		const char *written_name = nullptr; // flusher side
+		uint32_t id = 0;
+
+		void Push(const Event &event)
+		{
+			const size_t position = head.load(std::memory_order_relaxed);
+			if (position - tail.load(std::memory_order_acquire) >= Capacity)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			events[position % Capacity] = event;
+			head.store(position + 1, std::memory_order_release);
+		}
+	};
+
+	std::mutex lock; // guards everything below; never taken to record
+	std::vector<ThreadBuffer *> buffers;
+	uint32_t next_thread_id = 1;
+
+	FILE *file = nullptr;
+	bool first_event = true;
+	std::thread flusher;
+	std::condition_variable stop_requested;
+	bool stopping = false;
+
+	// Start stores the new origin and then bumps the generation (release), so whoever loads the generation (acquire)
+	// and then reads the clock gets an origin at least that new. Events from an older generation are dropped.
+	std::atomic<int64_t> epoch{ 0 }; // steady_clock microseconds at Start
+	std::atomic<uint32_t> generation{ 0 };
+
+	struct ThreadState
+	{
+		ThreadBuffer *buffer = nullptr; // created on the thread's first event
+		const char *name = nullptr;
+
+		~ThreadState()
+		{
+			if (buffer) buffer->retired.store(true, std::memory_order_release);
+		}
+	};
+
+	thread_local ThreadState CurrentThread;
+
+	ThreadBuffer *GetThreadBuffer()
+	{
+		if (!CurrentThread.buffer)
+		{
+			auto buffer = new ThreadBuffer();
+			buffer->name.store(CurrentThread.name, std::memory_order_relaxed);
+
+			std::lock_guard<std::mutex> guard(lock);
+			buffer->id = next_thread_id++;
+			buffers.push_back(buffer);
+			CurrentThread.buffer = buffer;
+		}
+
+		return CurrentThread.buffer;
+	}
+
+	uint32_t CurrentGeneration()
+	{
+		return generation.load(std::memory_order_acquire);
+	}
+
+	uint64_t Now()
+	{
+		const int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		return (uint64_t)(now - epoch.load(std::memory_order_relaxed));
+	}
+
+	void Record(uint32_t trace, char phase, const char *name, const char *category, const Trace::Arg *args, uint64_t start, uint64_t duration)
+	{
+		Event event{};
+		event.name = name;
+		event.category = category;
+		event.phase = phase;
+		event.start = start;
+		event.duration = duration;
+		event.generation = trace;
+		if (args)
+		{
+			event.args[0] = args[0];
+			event.args[1] = args[1];
+		}
+
+		GetThreadBuffer()->Push(event);
+	}
+
+	// Called with `lock` held
+	void WriteSeparator()
+	{
+		fprintf(file, first_event ? "\n" : ",\n");
+		first_event = false;
+	}
+
+	// Called with `lock` held
+	void WriteEvent(const Event &event, uint32_t tid)
+	{
+		WriteSeparator();
+		fprintf(file, "{\"ph\":\"%c\",\"name\":\"%s\",\"cat\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%llu", event.phase, event.name, event.category, tid, (unsigned long long)event.start);
+
+		if (event.phase == 'X')
+			fprintf(file, ",\"dur\":%llu", (unsigned long long)event.duration);
+		else
+			fprintf(file, ",\"s\":\"t\"");
+
+		if (event.args[0].name)
+		{
+			fprintf(file, ",\"args\":{");
+
+			for (int i = 0; i < 2 && event.args[i].name; i++)
+			{
+				const auto &arg = event.args[i];
+				if (arg.is_address)
+					fprintf(file, "%s\"%s\":\"0x%llx\"", i ? "," : "", arg.name, (unsigned long long)arg.value);
+				else
+					fprintf(file, "%s\"%s\":%llu", i ? "," : "", arg.name, (unsigned long long)arg.value);
+			}
+
+			fprintf(file, "}");
+		}
+
+		fprintf(file, "}");
+	}
+
+	// Called with `lock` held
+	void Drain()
+	{
+		for (auto it = buffers.begin(); it != buffers.end();)
+		{
+			ThreadBuffer *buffer = *it;
+			const bool retired = buffer->retired.load(std::memory_order_acquire); // before reading head, so nothing is missed
+			const size_t head = buffer->head.load(std::memory_order_acquire);
+			size_t tail = buffer->tail.load(std::memory_order_relaxed);
+			const uint32_t current = generation.load(std::memory_order_relaxed);
+
+			if (file)
+			{
+				const char *name = buffer->name.load(std::memory_order_relaxed);
+				if (name && name != buffer->written_name)
+				{
+					WriteSeparator();
+					fprintf(file, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", buffer->id, name);
+					buffer->written_name = name;
+				}
+
+				for (; tail != head; tail++)
+				{
+					// recorded against an earlier Start's origin, e.g. a span that was open across Stop and Start
+					const Event &event = buffer->events[tail % ThreadBuffer::Capacity];
+					if (event.generation == current)
+						WriteEvent(event, buffer->id);
+				}
+
+				if (const size_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed))
+					fprintf(stderr, "[Trace] Thread %u dropped %zu events\n", buffer->id, dropped);
+			}
+
+			buffer->tail.store(head, std::memory_order_release);
+
+			if (retired)
+			{
+				delete buffer;
+				it = buffers.erase(it);
+			}
+			else
+			{
+				it++;
+			}
+		}
+	}
+
+	void FlusherMain()
+	{
+		Trace::SetThreadName("trace flusher");
+
+		std::unique_lock<std::mutex> guard(lock);
+
+		while (!stopping)
+		{
+			stop_requested.wait_for(guard, std::chrono::milliseconds(100));
+			Drain();
+		}
+	}
+}
+
+bool Trace::Start(const std::filesystem::path &path)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (file)
+		return false;
+
+#ifdef _WIN32
+	file = _wfopen(path.c_str(), L"w");
+#else
+	file = fopen(path.c_str(), "w");
+#endif
+	if (!file)
+		return false;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	first_event = true;
+	stopping = false;
+	epoch.store(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+	generation.fetch_add(1, std::memory_order_release);
+
+	// anything left over from an earlier trace is stale
+	for (ThreadBuffer *buffer : buffers)
+	{
+		buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+		buffer->written_name = nullptr;
+	}
+
+	Enabled.store(true, std::memory_order_release);
+	flusher = std::thread(FlusherMain);
+	return true;
+}
+
+void Trace::Stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!file)
+			return;
+
+		Enabled.store(false, std::memory_order_release);
+		stopping = true;
+	}
+
+	stop_requested.notify_all();
+	flusher.join();
+
+	std::lock_guard<std::mutex> guard(lock);
+	Drain(); // spans that were open when tracing stopped
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	file = nullptr;
+}
+
+void Trace::SetThreadName(const char *name)
+{
+	// kept even while tracing is off, so threads started before Start still get their names
+	CurrentThread.name = name;
+	if (CurrentThread.buffer)
+		CurrentThread.buffer->name.store(name, std::memory_order_relaxed);
+}
+
+void Trace::Instant(const char *name, const char *category, Arg first, Arg second)
+{
+	if (!IsEnabled())
+		return;
+
+	const Arg args[2] = { first, second };
+	const uint32_t trace = CurrentGeneration();
+	Record(trace, 'i', name, category, args, Now(), 0);
+}
+
+void Trace::Span::Begin(const char *name, const char *category, Arg first, Arg second)
+{
+	this->name = name;
+	this->category = category;
+	args[0] = first;
+	args[1] = second;
+	generation = CurrentGeneration();
+	start = Now();
+}
+
+void Trace::Span::End()
+{
+	// a trace started since Begin measures from a later origin; the span belongs to neither
+	if (generation == CurrentGeneration())
+	{
+		const uint64_t end = Now();
+		Record(generation, 'X', name, category, args, start, end - start);
+	}
+
+	name = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+// Optional timeline of scanning and attach activity, written as Chrome trace-event JSON (open it in ui.perfetto.dev or
+// chrome://tracing). Every thread records into a ring buffer of its own that a background thread drains to the file, so
+// recording takes no lock (past a thread's first event). Off by default: a Span then costs one relaxed load.
+//
+// Names, categories and argument names are stored as pointers and must be string literals (or otherwise outlive Stop).
+namespace Trace
+{
+	extern std::atomic<bool> Enabled;
+
+	inline bool IsEnabled()
+	{
+		return Enabled.load(std::memory_order_relaxed);
+	}
+
+	// False if the file can't be created (or tracing is already on)
+	bool Start(const std::filesystem::path &path);
+
+	// Writes out everything recorded so far and closes the file
+	void Stop();
+
+	// Names the calling thread's track
+	void SetThreadName(const char *name);
+
+	struct Arg
+	{
+		const char *name = nullptr;
+		uint64_t value = 0;
+		bool is_address = false; // written as a hex string
+	};
+
+	inline Arg Value(const char *name, uint64_t value) { return { name, value, false }; }
+	inline Arg Address(const char *name, const void *value) { return { name, (uint64_t)(uintptr_t)value, true }; }
+
+	void Instant(const char *name, const char *category, Arg first = {}, Arg second = {});
+
+	// A complete event from construction to destruction
+	class Span
+	{
+	public:
+		Span(const char *name, const char *category, Arg first = {}, Arg second = {})
+		{
+			if (IsEnabled())
+				Begin(name, category, first, second);
+		}
+
+		~Span()
+		{
+			Stop();
+		}
+
+		Span(const Span &) = delete;
+		Span &operator=(const Span &) = delete;
+
+		// Ends the span early; later calls (and the destructor) do nothing
+		void Stop()
+		{
+			if (name)
+				End();
+		}
+
+	private:
+		void Begin(const char *name, const char *category, Arg first, Arg second);
+		void End();
+
+		const char *name = nullptr;
+		const char *category = nullptr;
+		Arg args[2];
+		uint64_t start = 0;
+		uint32_t generation = 0; // the trace Begin recorded into
+	};
+}
\ No newline at end of file
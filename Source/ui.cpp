@@ -2,11 +2,13 @@
 #include <shellapi.h>
 
 #include <cstdio>
+#include <string>
 
 #include "ui.h"
 #include "resource.h"
 #include "settings.h"
 #include "rfu.h"
+#include "phasestats.h"
 
 #define RFU_TRAYICON				(WM_APP + 1)
 #define RFU_TRAYMENU_APC			(WM_APP + 2)
@@ -21,6 +23,9 @@
 #define RFU_TRAYMENU_ADV_SE			(WM_APP + 11)
 #define RFU_TRAYMENU_ADV_QS			(WM_APP + 12)
 #define RFU_TRAYMENU_CLIENT			(WM_APP + 13)
+#define RFU_TRAYMENU_TIMINGS		(WM_APP + 17)
+#define RFU_WATCHTHREAD_EXITED		(WM_APP + 18)
+#define RFU_SHOWMESSAGE				(WM_APP + 19)
 
 #define RFU_TRAYMENU_UM				(WM_APP + 14)
 #define RFU_TRAYMENU_UM_HYBRID		(RFU_TRAYMENU_UM + static_cast<uint32_t>(Settings::UnlockMethodType::Hybrid))
@@ -36,8 +41,25 @@ int UI::AttachedProcessesCount = 0;
 bool UI::IsConsoleOnly = false;
 
 HANDLE WatchThread;
+LPTHREAD_START_ROUTINE WatchThreadRoutine;
 NOTIFYICONDATA NotifyIconData;
 
+// Posted with RFU_SHOWMESSAGE, owned by the UI thread once posted
+struct PendingMessage
+{
+	std::string title;
+	std::string text;
+	UINT type;
+};
+
+// The UI thread keeps pumping messages (RFU_SHOWMESSAGE from the watch thread's teardown included) until it's told the thread is done
+DWORD WINAPI RunWatchThread(LPVOID parameter)
+{
+	const DWORD result = WatchThreadRoutine(parameter);
+	PostMessage(UI::Window, RFU_WATCHTHREAD_EXITED, 0, 0);
+	return result;
+}
+
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
@@ -94,6 +116,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 			AppendMenu(popup, MF_SEPARATOR, 0, NULL);
 			AppendMenu(popup, MF_STRING, RFU_TRAYMENU_LOADSET, "Load Settings");
 			AppendMenu(popup, MF_STRING, RFU_TRAYMENU_CONSOLE, "Toggle Console");
+			AppendMenu(popup, MF_STRING, RFU_TRAYMENU_TIMINGS, "Print Attach Timings");
 			AppendMenu(popup, MF_STRING, RFU_TRAYMENU_GITHUB, "Visit GitHub");
 			AppendMenu(popup, MF_STRING, RFU_TRAYMENU_EXIT, "Exit");
 
@@ -105,17 +128,18 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 				switch (result)
 				{
 				case RFU_TRAYMENU_EXIT:
-					RFU_OnUIClose();
-					Shell_NotifyIcon(NIM_DELETE, &NotifyIconData);
-					TerminateThread(WatchThread, 0);
-					FreeConsole();
-					PostQuitMessage(0);
+					RFU_OnUIClose(); // finishes with RFU_WATCHTHREAD_EXITED
 					break;
 
 				case RFU_TRAYMENU_CONSOLE:
 					UI::ToggleConsole();
 					break;
 
+				case RFU_TRAYMENU_TIMINGS:
+					UI::SetConsoleVisible(true);
+					PhaseStats::Dump(stdout);
+					break;
+
 				case RFU_TRAYMENU_GITHUB:
 					ShellExecuteA(NULL, "open", "https://github.com/" RFU_GITHUB_REPO, NULL, NULL, SW_SHOWNORMAL);
 					break;
@@ -176,6 +200,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 				}
 
 				if (result != RFU_TRAYMENU_CONSOLE
+					&& result != RFU_TRAYMENU_TIMINGS
 					&& result != RFU_TRAYMENU_LOADSET
 					&& result != RFU_TRAYMENU_GITHUB
 					&& result != RFU_TRAYMENU_EXIT)
@@ -190,6 +215,22 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 		break;
 	}
+	case RFU_SHOWMESSAGE:
+	{
+		const auto message = reinterpret_cast<PendingMessage *>(lParam);
+		MessageBoxA(hwnd, message->text.c_str(), message->title.c_str(), message->type);
+		delete message;
+		break;
+	}
+	case RFU_WATCHTHREAD_EXITED:
+	{
+		WaitForSingleObject(WatchThread, INFINITE); // posted on its way out, so this doesn't wait long
+		CloseHandle(WatchThread);
+		Shell_NotifyIcon(NIM_DELETE, &NotifyIconData);
+		FreeConsole();
+		PostQuitMessage(0);
+		break;
+	}
 	default:
 		return DefWindowProc(hwnd, uMsg, wParam, lParam);
 	}
@@ -197,6 +238,19 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 	return 0;
 }
 
+void UI::ShowMessage(const char *title, const char *text, UINT type)
+{
+	if (!UI::Window)
+	{
+		MessageBoxA(NULL, text, title, type);
+		return;
+	}
+
+	auto message = new PendingMessage{ title, text, type };
+	if (!PostMessage(UI::Window, RFU_SHOWMESSAGE, 0, reinterpret_cast<LPARAM>(message)))
+		delete message; // the window is gone, we're exiting
+}
+
 bool IsConsoleVisible = false;
 
 void UI::SetConsoleVisible(bool visible)
@@ -270,7 +324,8 @@ int UI::Start(HINSTANCE instance, LPTHREAD_START_ROUTINE watchthread)
 
 	Shell_NotifyIcon(NIM_ADD, &NotifyIconData);
 
-	WatchThread = CreateThread(NULL, 0, watchthread, NULL, NULL, NULL);
+	WatchThreadRoutine = watchthread;
+	WatchThread = CreateThread(NULL, 0, RunWatchThread, NULL, NULL, NULL);
 
 	BOOL ret;
 	MSG msg;
@@ -285,4 +340,4 @@ int UI::Start(HINSTANCE instance, LPTHREAD_START_ROUTINE watchthread)
 	}
 
 	return msg.wParam;
-}
+}
\ No newline at end of file
@@ -9,6 +9,9 @@ namespace UI
 	bool ToggleConsole();
 	int Start(HINSTANCE instance, LPTHREAD_START_ROUTINE watchthread);
 
+	// From any thread: the message box is shown by the UI thread (right away if there's no tray window), so the caller never waits on it
+	void ShowMessage(const char *title, const char *text, UINT type);
+
 	extern HWND Window;
 	extern int AttachedProcessesCount;
 	extern bool IsConsoleOnly;
@@ -0,0 +1,172 @@
+#include "wine.h"
+
+#ifdef __linux__
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "pe.h"
+
+namespace
+{
+	struct DirectoryEntry64 // struct linux_dirent64
+	{
+		uint64_t inode;
+		int64_t offset;
+		unsigned short length;
+		unsigned char type;
+		char name[1];
+	};
+
+	// Reads /proc/<pid>/<file> (as much as fits) into `buffer` and NUL-terminates it, without allocating
+	ssize_t ReadProcFile(int proc, const char *pid, const char *file, char *buffer, size_t size)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), "%s/%s", pid, file);
+
+		const int fd = openat(proc, path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return -1;
+
+		const ssize_t length = read(fd, buffer, size - 1);
+		close(fd);
+
+		if (length < 0)
+			return -1;
+
+		buffer[length] = '\0';
+		return length;
+	}
+
+	// Wine passes the Windows path as argv[0]; fall back to '/' for processes started with a Unix path.
+	// (comm would be cheaper to read but is cut to 15 characters, and /proc/<pid>/exe is the Wine preloader.)
+	const char *GetImageName(const char *argv0)
+	{
+		const char *name = argv0;
+		for (const char *i = argv0; *i; i++)
+		{
+			if (*i == '\\' || *i == '/')
+				name = i + 1;
+		}
+
+		return name;
+	}
+
+	// Field 22 of /proc/<pid>/stat, in clock ticks since boot
+	uint64_t ReadStartTime(int proc, const char *pid)
+	{
+		char stat[512];
+		if (ReadProcFile(proc, pid, "stat", stat, sizeof(stat)) <= 0)
+			return 0;
+
+		// comm (field 2) may contain spaces and parentheses, the fields after it start past the last ')'
+		const char *field = strrchr(stat, ')');
+		for (int i = 2; field && i < 22; i++)
+			field = strchr(field + 1, ' ');
+
+		return field ? strtoull(field + 1, nullptr, 10) : 0;
+	}
+}
+
+uint64_t Wine::GetStartTime(pid_t pid)
+{
+	char directory[32];
+	snprintf(directory, sizeof(directory), "/proc/%d", (int)pid);
+	return ReadStartTime(AT_FDCWD, directory); // absolute, so the directory fd isn't used
+}
+
+std::vector<Wine::ProcessMatch> Wine::FindProcessesByImageNames(const std::vector<const char *> &image_names)
+{
+	std::vector<ProcessMatch> result;
+	if (image_names.empty())
+		return result;
+
+	const int proc = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (proc < 0)
+		return result;
+
+	alignas(DirectoryEntry64) char entries[16 * 1024];
+	char cmdline[1024];
+
+	while (true)
+	{
+		const long size = syscall(SYS_getdents64, proc, entries, sizeof(entries));
+		if (size <= 0)
+			break;
+
+		for (long offset = 0; offset < size;)
+		{
+			const auto entry = (const DirectoryEntry64 *)(entries + offset);
+			offset += entry->length;
+
+			if (entry->name[0] < '1' || entry->name[0] > '9')
+				continue; // not a process
+
+			if (ReadProcFile(proc, entry->name, "cmdline", cmdline, sizeof(cmdline)) <= 0)
+				continue; // gone, or a kernel thread
+
+			const char *image_name = GetImageName(cmdline);
+
+			for (size_t i = 0; i < image_names.size(); i++)
+			{
+				if (strcasecmp(image_name, image_names[i]) == 0)
+				{
+					result.push_back({ (pid_t)strtol(entry->name, nullptr, 10), i, ReadStartTime(proc, entry->name) });
+					break;
+				}
+			}
+		}
+	}
+
+	close(proc);
+	return result;
+}
+
+Wine::WineMemorySource::WineMemorySource(pid_t pid, std::string image_name)
+	: LinuxMemorySource(pid), image_name(std::move(image_name))
+{
+}
+
+bool Wine::WineMemorySource::Is64Bit()
+{
+	if (!is_64bit.has_value())
+	{
+		ProcUtil::ModuleInfo module{};
+		uint8_t header[PE::HeaderReadSize];
+		PE::Headers headers{};
+
+		if (!GetMainModule(module) || !Read(module.base, header, sizeof(header)) || !PE::ParseHeaders(header, sizeof(header), headers))
+			return true; // don't cache, the image may not be mapped yet
+
+		is_64bit = headers.is_64bit;
+	}
+
+	return *is_64bit;
+}
+
+bool Wine::WineMemorySource::GetMainModule(ProcUtil::ModuleInfo &out)
+{
+	for (auto &module : GetModules())
+	{
+		if (strcasecmp(module.path.filename().string().c_str(), image_name.c_str()) != 0)
+			continue;
+
+		// Wine maps the sections separately, so the mappings of the file may not cover the whole image; SizeOfImage does
+		uint8_t header[PE::HeaderReadSize];
+		PE::Headers headers{};
+		if (Read(module.base, header, sizeof(header)) && PE::ParseHeaders(header, sizeof(header), headers))
+			module.size = headers.size_of_image;
+
+		out = std::move(module);
+		return true;
+	}
+
+	return false;
+}
+
+#endif
\ No newline at end of file
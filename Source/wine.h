@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "linuxmemory.h"
+
+// Windows Roblox clients running under Wine, seen from the Linux side
+namespace Wine
+{
+	struct ProcessMatch
+	{
+		pid_t id;
+		size_t image; // index of the matching name
+		uint64_t start_time; // clock ticks since boot, tells a reused pid apart from the process it used to be; 0 if unknown
+	};
+
+	// Processes whose Windows image name (argv[0] as Wine sets it, e.g. C:\...\RobloxPlayerBeta.exe) matches one of
+	// `image_names`, case-insensitively. One pass over /proc for all of them.
+	std::vector<ProcessMatch> FindProcessesByImageNames(const std::vector<const char *> &image_names);
+
+	// Same as ProcessMatch::start_time; 0 once the process is gone
+	uint64_t GetStartTime(pid_t pid);
+
+	// LinuxMemorySource for a Wine process: the main module is the PE image mapped from `image_name`
+	// rather than /proc/<pid>/exe (which is the Wine preloader), and its bitness comes from the PE headers
+	class WineMemorySource : public ProcUtil::LinuxMemorySource
+	{
+	public:
+		WineMemorySource(pid_t pid, std::string image_name);
+
+		bool Is64Bit() override;
+		bool GetMainModule(ProcUtil::ModuleInfo &out) override;
+
+	private:
+		std::string image_name;
+		std::optional<bool> is_64bit;
+	};
+}
+
+#endif
\ No newline at end of file
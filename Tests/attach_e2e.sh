@@ -0,0 +1,40 @@
+#!/bin/sh
+# End-to-end attach: two stand-in clients of the same build, one scanned and one reusing the shared offsets, both have to
+# end up at the requested cap. Usage: attach_e2e.sh <rbxfpsunlocker> <standin>
+
+unlocker=$1
+standin=$2
+
+work=$(mktemp -d) || exit 1
+unlocker_pid=
+trap 'if [ -n "$unlocker_pid" ]; then kill "$unlocker_pid" 2>/dev/null; fi; rm -rf "$work"' EXIT
+cd "$work" || exit 1
+
+"$standin" --image RobloxPlayerBeta.exe || exit 1
+
+"$standin" RobloxPlayerBeta.exe > standin1.out 2>&1 &
+standin1=$!
+"$standin" RobloxPlayerBeta.exe > standin2.out 2>&1 &
+standin2=$!
+
+"$unlocker" --fps 144 --method memory > unlocker.out 2>&1 &
+unlocker_pid=$!
+
+wait "$standin1"
+result1=$?
+wait "$standin2"
+result2=$?
+
+kill -INT "$unlocker_pid"
+wait "$unlocker_pid"
+unlocker_result=$?
+unlocker_pid=
+
+for out in unlocker.out standin1.out standin2.out
+do
+	echo "--- $out"
+	cat "$out"
+done
+
+[ "$result1" -eq 0 ] && [ "$result2" -eq 0 ] && [ "$unlocker_result" -eq 0 ] || exit 1
+grep -q "(144.0 fps)" standin1.out && grep -q "(144.0 fps)" standin2.out
\ No newline at end of file
@@ -0,0 +1,108 @@
+// AttachPipeline keys its entries on (pid, start time): a pid reused by a new process isn't mistaken for the attached one,
+// and adding it replaces the entry the old process left behind. Wine::GetStartTime is what the Linux front-end compares.
+
+#include "attachpipeline.h"
+#include "wine.h"
+
+#include <cstdio>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} \
+	while (0)
+
+// what the front-ends provide
+void NotifyError(const char *, const char *error)
+{
+	printf("[ERROR] %s\n", error);
+}
+
+void NotifyInfo(const char *title, const char *message)
+{
+	printf("[%s] %s\n", title, message);
+}
+
+void RFU_SetFPSCap(double)
+{
+}
+
+namespace
+{
+	int failures = 0;
+
+	// Never finds its main module, so the process stays in AttachState::Module until it's removed
+	std::unique_ptr<ProcUtil::MemorySource> CreateSource()
+	{
+		return std::make_unique<Wine::WineMemorySource>(getpid(), "RobloxPlayerBeta.exe");
+	}
+}
+
+int main()
+{
+	const pid_t pid = getpid();
+
+	// our own start time is known, an exited (and reaped) child's isn't
+	const uint64_t own_start_time = Wine::GetStartTime(pid);
+	CHECK(own_start_time != 0);
+	CHECK(Wine::GetStartTime(pid) == own_start_time);
+
+	const pid_t child = fork();
+	if (child == 0)
+		_exit(0);
+
+	CHECK(child > 0);
+	waitpid(child, nullptr, 0);
+	CHECK(Wine::GetStartTime(child) == 0);
+
+	{
+		AttachPipeline pipeline(1);
+
+		pipeline.Add(pid, 100, CreateSource(), RobloxHandleType::Client, 0);
+		CHECK(pipeline.Contains(pid, 100));
+		CHECK(pipeline.Contains(pid, 0)); // unknown start time
+		CHECK(!pipeline.Contains(pid, 200)); // the pid was reused
+		CHECK(!pipeline.Contains(pid + 1, 100));
+
+		// the new process replaces the one that had its pid
+		pipeline.Add(pid, 200, CreateSource(), RobloxHandleType::Client, 0);
+		CHECK(pipeline.GetCount() == 1);
+		CHECK(pipeline.Contains(pid, 200));
+		CHECK(!pipeline.Contains(pid, 100));
+
+		std::vector<AttachPipeline::StartTime> seen;
+		pipeline.RemoveIf([&](AttachPipeline::Id id, AttachPipeline::StartTime start_time, RobloxProcess &)
+		{
+			CHECK(id == (AttachPipeline::Id)pid);
+			seen.push_back(start_time);
+			return start_time == 100;
+		});
+
+		CHECK(seen.size() == 1 && seen[0] == 200);
+		CHECK(pipeline.GetCount() == 1);
+
+		pipeline.RemoveIf([](AttachPipeline::Id, AttachPipeline::StartTime start_time, RobloxProcess &)
+		{
+			return start_time == 200;
+		});
+
+		CHECK(pipeline.GetCount() == 0);
+		CHECK(!pipeline.Contains(pid, 200));
+		pipeline.WaitIdle();
+	}
+
+	if (failures)
+		return 1;
+
+	printf("Attach pipeline identity passed\n");
+	return 0;
+}
\ No newline at end of file
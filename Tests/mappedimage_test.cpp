@@ -0,0 +1,306 @@
+// MappedImage on small PE fixtures written to a temporary file: section to RVA mapping with a file alignment that differs
+// from the section alignment, rebasing to a live base, and the rel32/absolute operands the signatures resolve through it.
+
+#include "mappedimage.h"
+#include "signatures.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} \
+	while (0)
+
+namespace
+{
+	int failures = 0;
+
+	struct SectionSpec
+	{
+		const char *name;
+		uint32_t rva;
+		uint32_t virtual_size;
+		uint32_t raw_offset;
+		uint32_t raw_size;
+		uint32_t characteristics;
+	};
+
+	const uint32_t Code = 0x60000020; // IMAGE_SCN_CNT_CODE | MEM_EXECUTE | MEM_READ
+	const uint32_t ReadOnlyData = 0x40000040;
+	const uint32_t WritableData = 0xC0000040;
+	const uint32_t Uninitialized = 0xC0000080;
+
+	class Fixture
+	{
+	public:
+		Fixture(bool is_64bit, uint64_t image_base, uint32_t size_of_image, uint32_t size_of_headers, const std::vector<SectionSpec> &sections)
+		{
+			const size_t nt = 0x80;
+			const size_t file_header = nt + 4;
+			const size_t optional_header = file_header + 20;
+			const uint16_t optional_size = is_64bit ? 240 : 224;
+
+			Put<uint16_t>(0, 0x5A4D);
+			Put<uint32_t>(0x3C, nt);
+			Put<uint32_t>(nt, 0x00004550);
+
+			Put<uint16_t>(file_header, is_64bit ? 0x8664 : 0x14C);
+			Put<uint16_t>(file_header + 2, (uint16_t)sections.size());
+			Put<uint32_t>(file_header + 4, 0x5EED);
+			Put<uint16_t>(file_header + 16, optional_size);
+
+			Put<uint16_t>(optional_header, is_64bit ? 0x20B : 0x10B);
+			if (is_64bit)
+				Put<uint64_t>(optional_header + 24, image_base);
+			else
+				Put<uint32_t>(optional_header + 28, (uint32_t)image_base);
+			Put<uint32_t>(optional_header + 56, size_of_image);
+			Put<uint32_t>(optional_header + 60, size_of_headers);
+
+			size_t entry = optional_header + optional_size;
+			for (const auto &section : sections)
+			{
+				memcpy(Reserve(entry, 8), section.name, strlen(section.name));
+				Put<uint32_t>(entry + 8, section.virtual_size);
+				Put<uint32_t>(entry + 12, section.rva);
+				Put<uint32_t>(entry + 16, section.raw_size);
+				Put<uint32_t>(entry + 20, section.raw_offset);
+				Put<uint32_t>(entry + 36, section.characteristics);
+
+				// int3 filler, which none of the signatures contain
+				if (section.raw_size)
+					memset(Reserve(section.raw_offset, section.raw_size), 0xCC, section.raw_size);
+
+				entry += 40;
+			}
+		}
+
+		template <typename T>
+		void Put(size_t offset, T value)
+		{
+			memcpy(Reserve(offset, sizeof(value)), &value, sizeof(value));
+		}
+
+		void PutBytes(size_t offset, const char *bytes, size_t size)
+		{
+			memcpy(Reserve(offset, size), bytes, size);
+		}
+
+		// Writes the fixture to a temporary file and maps it at `base`
+		bool Map(const void *base, std::unique_ptr<MappedImage> &out)
+		{
+			path = std::filesystem::temp_directory_path() / ("rfu-mappedimage-test-" + std::to_string(getpid()) + ".exe");
+
+			FILE *file = fopen(path.c_str(), "wb");
+			if (!file)
+				return false;
+
+			const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+			if (fclose(file) != 0 || !written)
+				return false;
+
+			out = std::make_unique<MappedImage>(path, base);
+			return out->IsOpen();
+		}
+
+		~Fixture()
+		{
+			if (!path.empty())
+				std::filesystem::remove(path);
+		}
+
+		std::vector<uint8_t> data;
+
+	private:
+		uint8_t *Reserve(size_t offset, size_t size)
+		{
+			if (data.size() < offset + size)
+				data.resize(offset + size);
+
+			return data.data() + offset;
+		}
+
+		std::filesystem::path path;
+	};
+
+	// PE32 with a 0x200 file alignment: .text at file 0x400, .rdata at file 0x2600 with more raw data than virtual size, .bss
+	void TestImage32()
+	{
+		const uint64_t image_base = 0x400000;
+		const auto base = (const uint8_t *)0x10000000;
+
+		Fixture fixture(false, image_base, 0x5000, 0x400, {
+			{ ".text", 0x1000, 0x2000, 0x400, 0x2000, Code },
+			{ ".rdata", 0x3000, 0x800, 0x2600, 0x1000, ReadOnlyData },
+			{ ".bss", 0x4000, 0x1000, 0, 0, Uninitialized }
+		});
+
+		// ltcg signature at .text+0x100 calling GetTaskScheduler at .text+0x800, which loads the pointer at .bss+0x10
+		const uint32_t signature_rva = 0x1100, function_rva = 0x1800, pointer_rva = 0x4010;
+		fixture.PutBytes(0x400 + (signature_rva - 0x1000), "\x55\x8B\xEC\x83\xE4\xF8\x83\xEC\x08\xE8\x00\x00\x00\x00\x8D\x0C\x24", 17);
+		fixture.Put<int32_t>(0x400 + (signature_rva - 0x1000) + 10, (int32_t)(function_rva - (signature_rva + 14)));
+		fixture.PutBytes(0x400 + (function_rva - 0x1000), "\xA1\x00\x00\x00\x00\x8B\x4D\xF4", 8);
+		fixture.Put<uint32_t>(0x400 + (function_rva - 0x1000) + 1, (uint32_t)(image_base + pointer_rva));
+
+		// straddles the end of .text and the start of .rdata, which are adjacent once loaded but not in the file
+		fixture.PutBytes(0x23FE, "\x11\x22", 2);
+		fixture.PutBytes(0x2600, "\x33\x44", 2);
+		fixture.PutBytes(0x2400, "\x33\x44", 2); // file alignment padding right after .text, never loaded
+
+		std::unique_ptr<MappedImage> image;
+		CHECK(fixture.Map(base, image));
+		if (!image)
+			return;
+
+		const auto &headers = image->GetHeaders();
+		CHECK(!headers.is_64bit);
+		CHECK(headers.machine == 0x14C);
+		CHECK(headers.image_base == image_base);
+		CHECK(headers.sections.size() == 3);
+
+		CHECK(image->GetCodeRange() == std::make_pair(base + 0x1000, base + 0x3000));
+		CHECK(image->GetRelocationDelta() == (intptr_t)((uintptr_t)base - image_base));
+
+		size_t offset = 0;
+		CHECK(headers.RvaToFileOffset(0x80, offset) && offset == 0x80);
+		CHECK(headers.RvaToFileOffset(0x1100, offset) && offset == 0x500);
+		CHECK(headers.RvaToFileOffset(0x3004, offset) && offset == 0x2604);
+		CHECK(!headers.RvaToFileOffset(pointer_rva, offset));
+
+		// Get maps live addresses to the file through the section table
+		const uint8_t *local = image->Get(base + 0x80, 4);
+		CHECK(local && memcmp(local, "PE\0\0", 4) == 0);
+		local = image->Get(base + signature_rva, 17);
+		CHECK(local && memcmp(local, fixture.data.data() + 0x500, 17) == 0);
+		local = image->Get(base + 0x3000, 2);
+		CHECK(local && memcmp(local, "\x33\x44", 2) == 0);
+		CHECK(image->Get(base + 0x37FF, 1) != nullptr);
+		CHECK(image->Get(base + 0x3800, 1) == nullptr); // raw data past the virtual size isn't loaded
+		CHECK(image->Get(base + 0x2FFE, 4) == nullptr); // spans two sections
+		CHECK(image->Get(base + pointer_rva, 4) == nullptr); // zero-filled at load
+		CHECK(image->Get(base - 1, 1) == nullptr);
+		CHECK(image->Get(base + 0x5000, 1) == nullptr);
+
+		// scans see the image as loaded
+		std::vector<const uint8_t *> hits;
+		image->ScanAll("\x11\x22\x33\x44", "xxxx", [&](const uint8_t *address, const uint8_t *bytes)
+		{
+			CHECK(memcmp(bytes, "\x11\x22\x33\x44", 4) == 0);
+			hits.push_back(address);
+			return true;
+		}, base, base + headers.size_of_image);
+		CHECK(hits == std::vector<const uint8_t *>{ base + 0x2FFE });
+
+		// the absolute operand is relative to the preferred base in the file and has to come out rebased
+		std::vector<const void *> pointers;
+		const char *variant = nullptr;
+		CHECK(Signatures::FindTaskSchedulerPointers(*image, false, nullptr, pointers, &variant));
+		CHECK(pointers == std::vector<const void *>{ base + pointer_rva });
+		CHECK(variant && strcmp(variant, "ltcg") == 0);
+	}
+
+	// PE32+ with the studio signature after GetTaskScheduler (a negative rel32 call), whose RIP-relative load points into .data
+	void TestImage64Studio()
+	{
+		const auto base = (const uint8_t *)0x7FF600000000;
+
+		Fixture fixture(true, 0x140000000, 0x4000, 0x400, {
+			{ ".text", 0x1000, 0x2000, 0x400, 0x2000, Code },
+			{ ".data", 0x3000, 0x1000, 0x2400, 0x200, WritableData }
+		});
+
+		const uint32_t function_rva = 0x1200, signature_rva = 0x2000, pointer_rva = 0x3010;
+		fixture.PutBytes(0x400 + (signature_rva - 0x1000), "\x40\x53\x48\x83\xEC\x20\x0F\xB6\xD9\xE8\x00\x00\x00\x00\x86\x58\x04\x48\x83\xC4\x20\x5B\xC3", 23);
+		fixture.Put<int32_t>(0x400 + (signature_rva - 0x1000) + 10, (int32_t)(function_rva - (signature_rva + 14)));
+
+		const uint32_t load_rva = function_rva + 0x20;
+		fixture.PutBytes(0x400 + (load_rva - 0x1000), "\x48\x8B\x05\x00\x00\x00\x00\x48\x83\xC4\x28", 11);
+		fixture.Put<int32_t>(0x400 + (load_rva - 0x1000) + 3, (int32_t)(pointer_rva - (load_rva + 7)));
+
+		std::unique_ptr<MappedImage> image;
+		CHECK(fixture.Map(base, image));
+		if (!image)
+			return;
+
+		CHECK(image->GetHeaders().is_64bit);
+		CHECK(image->GetHeaders().image_base == 0x140000000);
+		CHECK(image->GetCodeRange() == std::make_pair(base + 0x1000, base + 0x3000));
+		CHECK(image->Get(base + 0x3000, 0x200) != nullptr);
+		CHECK(image->Get(base + 0x3200, 1) == nullptr); // rest of .data is zero-filled
+
+		std::vector<const void *> pointers;
+		const char *variant = nullptr;
+		CHECK(Signatures::FindTaskSchedulerPointers(*image, true, nullptr, pointers, &variant));
+		CHECK(pointers == std::vector<const void *>{ base + pointer_rva });
+		CHECK(variant && strcmp(variant, "studio") == 0);
+	}
+
+	// PE32+ without the studio signature: every RIP-relative load of the Byfron getter is a candidate
+	void TestImage64Byfron()
+	{
+		const auto base = (const uint8_t *)0x7FF700000000;
+
+		Fixture fixture(true, 0x140000000, 0x4000, 0x400, {
+			{ ".text", 0x1000, 0x2000, 0x400, 0x2000, Code },
+			{ ".data", 0x3000, 0x1000, 0x2400, 0x200, WritableData }
+		});
+
+		std::set<const void *> expected;
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			const uint32_t load_rva = 0x1100 + i * 0x300, pointer_rva = 0x3100 - i * 0x20;
+			fixture.PutBytes(0x400 + (load_rva - 0x1000), "\x48\x8B\x05\x00\x00\x00\x00\x48\x83\xC4\x48\xC3", 12);
+			fixture.Put<int32_t>(0x400 + (load_rva - 0x1000) + 3, (int32_t)(pointer_rva - (load_rva + 7)));
+			expected.insert(base + pointer_rva);
+		}
+
+		std::unique_ptr<MappedImage> image;
+		CHECK(fixture.Map(base, image));
+		if (!image)
+			return;
+
+		std::vector<const void *> pointers;
+		const char *variant = nullptr;
+		CHECK(Signatures::FindTaskSchedulerPointers(*image, true, nullptr, pointers, &variant));
+		CHECK(std::set<const void *>(pointers.begin(), pointers.end()) == expected);
+		CHECK(variant && strcmp(variant, "byfron") == 0);
+	}
+
+	void TestNotAnImage()
+	{
+		Fixture fixture(false, 0x400000, 0x2000, 0x400, {});
+		fixture.Put<uint16_t>(0, 0x5A4E);
+
+		std::unique_ptr<MappedImage> image;
+		CHECK(!fixture.Map((const void *)0x10000000, image));
+		CHECK(image && image->Get((const void *)0x10000000, 1) == nullptr);
+	}
+}
+
+int main()
+{
+	TestImage32();
+	TestImage64Studio();
+	TestImage64Byfron();
+	TestNotAnImage();
+
+	if (failures)
+		return 1;
+
+	printf("MappedImage fixtures passed\n");
+	return 0;
+}
\ No newline at end of file
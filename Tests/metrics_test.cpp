@@ -0,0 +1,146 @@
+// The metrics endpoint on Linux: what a client reads from the socket is the Render output of the counters recorded so far,
+// a socket left behind by an unclean exit is taken over, and Stop removes the socket again.
+
+#include "metrics.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} \
+	while (0)
+
+namespace
+{
+	int failures = 0;
+
+	sockaddr_un GetAddress(const std::string &path)
+	{
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+		return address;
+	}
+
+	// Connects and reads until the server closes the connection
+	bool Fetch(const std::string &path, std::string &out)
+	{
+		const int client = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (client < 0)
+			return false;
+
+		const sockaddr_un address = GetAddress(path);
+		if (connect(client, (const sockaddr *)&address, sizeof(address)) != 0)
+		{
+			close(client);
+			return false;
+		}
+
+		char buffer[4096];
+		ssize_t received;
+		while ((received = recv(client, buffer, sizeof(buffer), 0)) > 0)
+			out.append(buffer, (size_t)received);
+
+		close(client);
+		return received == 0;
+	}
+
+	bool Contains(const std::string &text, const char *line)
+	{
+		return text.find(std::string(line) + "\n") != std::string::npos;
+	}
+}
+
+int main()
+{
+	const std::string path = "/tmp/rfu-metrics-test-" + std::to_string(getpid()) + ".sock";
+
+	// a socket nobody listens on, as left behind by a run that was killed
+	const int stale = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	const sockaddr_un address = GetAddress(path);
+	CHECK(stale >= 0 && bind(stale, (const sockaddr *)&address, sizeof(address)) == 0);
+	close(stale);
+	CHECK(access(path.c_str(), F_OK) == 0);
+
+	CHECK(Metrics::Start(path.c_str()));
+	CHECK(!Metrics::Start(path.c_str())); // serving already
+
+	Metrics::SetAttachedProcesses(3);
+	Metrics::RecordAttach("byfron", true);
+	Metrics::RecordAttach("byfron", true);
+	Metrics::RecordAttach("shared", false);
+	Metrics::RecordAttach("something new", false);
+	Metrics::RecordRetry(Metrics::Retry::Scan);
+	Metrics::RecordFlagsFileWrite(false);
+
+	std::string served;
+	CHECK(Fetch(path, served));
+
+	std::string rendered;
+	Metrics::Render(rendered);
+	CHECK(served == rendered);
+
+	CHECK(Contains(served, "# TYPE rfu_attached_processes gauge"));
+	CHECK(Contains(served, "rfu_attached_processes 3"));
+	CHECK(Contains(served, "rfu_attaches_total{variant=\"byfron\",result=\"success\"} 2"));
+	CHECK(Contains(served, "rfu_attaches_total{variant=\"shared\",result=\"failure\"} 1"));
+	CHECK(Contains(served, "rfu_attaches_total{variant=\"other\",result=\"failure\"} 1"));
+	CHECK(Contains(served, "rfu_attach_retries_total{step=\"scan\"} 1"));
+	CHECK(Contains(served, "rfu_attach_retries_total{step=\"module\"} 0"));
+	CHECK(Contains(served, "rfu_flags_file_writes_total{result=\"failure\"} 1"));
+
+	// every sample is `name{labels} value`
+	for (size_t start = 0; start < served.size();)
+	{
+		const size_t end = served.find('\n', start);
+		CHECK(end != std::string::npos);
+		if (end == std::string::npos)
+			break;
+
+		const std::string line = served.substr(start, end - start);
+		if (line[0] != '#')
+		{
+			const size_t space = line.rfind(' ');
+			char *number_end = nullptr;
+			CHECK(space != std::string::npos && space > 0);
+			strtod(line.c_str() + space + 1, &number_end);
+			CHECK(*number_end == '\0' && number_end != line.c_str() + space + 1);
+		}
+
+		start = end + 1;
+	}
+
+	// a later connection sees later counts
+	Metrics::SetAttachedProcesses(1);
+	std::string second;
+	CHECK(Fetch(path, second));
+	CHECK(Contains(second, "rfu_attached_processes 1"));
+
+	Metrics::Stop();
+	CHECK(access(path.c_str(), F_OK) != 0);
+
+	std::string after;
+	CHECK(!Fetch(path, after));
+
+	// and it can be served again
+	CHECK(Metrics::Start(path.c_str()));
+	Metrics::Stop();
+
+	if (failures)
+		return 1;
+
+	printf("Metrics endpoint passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+// PhaseStats histograms: every bucket's floor maps back to that bucket, values up to the largest exponent stay inside the
+// array, and the reported percentiles are the upper bound of the bucket holding the exact one (so within 1/16 above it).
+
+#include "phasestats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} \
+	while (0)
+
+namespace
+{
+	int failures = 0;
+
+	void Record(uint64_t us)
+	{
+		PhaseStats::Record(PhaseStats::Phase::SignatureScan, std::chrono::microseconds(us));
+	}
+
+	// Upper bound of the bucket holding `us`
+	uint64_t GetBucketCeiling(uint64_t us)
+	{
+		const size_t bucket = PhaseStats::GetBucket(us);
+		if (bucket + 1 >= PhaseStats::GetBucketCount())
+			return UINT64_MAX;
+
+		return PhaseStats::GetBucketFloor(bucket + 1) - 1;
+	}
+}
+
+int main()
+{
+	const size_t count = PhaseStats::GetBucketCount();
+
+	// floors round-trip and grow, and the value just below a floor is in the previous bucket
+	for (size_t bucket = 0; bucket < count; bucket++)
+	{
+		const uint64_t floor = PhaseStats::GetBucketFloor(bucket);
+		CHECK(PhaseStats::GetBucket(floor) == bucket);
+
+		if (bucket > 0)
+		{
+			CHECK(floor > PhaseStats::GetBucketFloor(bucket - 1));
+			CHECK(PhaseStats::GetBucket(floor - 1) == bucket - 1);
+		}
+	}
+
+	// every exponent up to the largest has its own buckets, anything past it shares the last one
+	for (int exponent = 0; exponent < 64; exponent++)
+	{
+		const uint64_t power = 1ull << exponent;
+		CHECK(PhaseStats::GetBucket(power) < count);
+		CHECK(PhaseStats::GetBucket(power + power / 2) < count);
+		CHECK(PhaseStats::GetBucket(power - 1 + power) < count);
+	}
+
+	CHECK(PhaseStats::GetBucket(1ull << 40) == count - 16);
+	CHECK(PhaseStats::GetBucket((1ull << 41) - 1) == count - 1);
+	CHECK(PhaseStats::GetBucket(1ull << 41) == count - 1);
+	CHECK(PhaseStats::GetBucket(UINT64_MAX) == count - 1);
+
+	// values below 16us are exact, the rest within 1/16
+	std::mt19937_64 rng(1337);
+	for (int i = 0; i < 100000; i++)
+	{
+		const uint64_t value = rng() >> (rng() % 64);
+		const size_t bucket = PhaseStats::GetBucket(value);
+		CHECK(PhaseStats::GetBucketFloor(bucket) <= value);
+
+		if (bucket + 1 < count)
+		{
+			CHECK(value < PhaseStats::GetBucketFloor(bucket + 1));
+			CHECK(value - PhaseStats::GetBucketFloor(bucket) <= value / 16);
+		}
+	}
+
+	// percentiles of 1..1000us
+	PhaseStats::Reset();
+
+	std::vector<uint64_t> values;
+	for (uint64_t us = 1; us <= 1000; us++) values.push_back(us);
+	std::shuffle(values.begin(), values.end(), rng);
+	for (uint64_t us : values) Record(us);
+
+	auto summary = PhaseStats::GetSummary(PhaseStats::Phase::SignatureScan);
+	CHECK(summary.count == 1000);
+	CHECK(summary.total_us == 500500);
+	CHECK(summary.max_us == 1000);
+	CHECK(summary.p50_us == GetBucketCeiling(500));
+	CHECK(summary.p90_us == GetBucketCeiling(900));
+	CHECK(summary.p99_us == std::min<uint64_t>(GetBucketCeiling(990), 1000));
+
+	// a bucket's floor comes back as that bucket's upper bound, not the next one's
+	for (size_t bucket = 0; bucket + 1 < count; bucket += 7)
+	{
+		PhaseStats::Reset();
+
+		const uint64_t floor = PhaseStats::GetBucketFloor(bucket);
+		Record(floor);
+		Record(floor);
+		Record(1ull << 45);
+
+		summary = PhaseStats::GetSummary(PhaseStats::Phase::SignatureScan);
+		CHECK(summary.p50_us == PhaseStats::GetBucketFloor(bucket + 1) - 1);
+	}
+
+	// the largest durations are counted, not written past the buckets
+	PhaseStats::Reset();
+	Record(1ull << 40);
+	Record((1ull << 41) - 1);
+	Record(1ull << 50);
+
+	summary = PhaseStats::GetSummary(PhaseStats::Phase::SignatureScan);
+	CHECK(summary.count == 3);
+	CHECK(summary.max_us == 1ull << 50);
+	CHECK(summary.p50_us == 1ull << 50); // the last bucket has no upper bound but the maximum
+
+	if (failures)
+		return 1;
+
+	printf("%zu histogram buckets passed\n", count);
+	return 0;
+}
\ No newline at end of file
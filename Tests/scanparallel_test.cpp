@@ -0,0 +1,187 @@
+// ScanProcessParallel against ScanProcess on fake processes with unreadable regions and with reads that fail inside regions
+// the layout calls readable (stale region map, guard pages): both have to report the same lowest match, whatever the pool size.
+
+#include "memorysource.h"
+#include "regionmap.h"
+#include "threadpool.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const size_t PageSize = 0x1000;
+
+	struct Range
+	{
+		size_t start;
+		size_t end;
+	};
+
+	class FakeMemory : public ProcUtil::MemorySource
+	{
+	public:
+		std::vector<uint8_t> image;
+		std::vector<ProcUtil::MemoryRegion> regions; // contiguous, covering the image
+		std::vector<Range> failing; // offsets whose reads fail even though their region is readable
+
+		const uint8_t *Base() const { return (const uint8_t *)0x40000000; }
+
+		const void *GetTag() const override { return this; }
+		bool Is64Bit() override { return true; }
+
+		bool Read(const void *address, void *buffer, size_t size, size_t *bytes_read = nullptr) override
+		{
+			if (bytes_read) *bytes_read = 0;
+
+			const uint8_t *remote = (const uint8_t *)address;
+			if (remote < Base() || remote + size > Base() + image.size())
+				return false;
+
+			const size_t offset = remote - Base();
+			for (const auto &range : failing)
+			{
+				if (offset < range.end && offset + size > range.start)
+					return false;
+			}
+
+			for (const auto &region : regions)
+			{
+				if (!region.readable && remote < region.base + region.size && remote + size > region.base)
+					return false;
+			}
+
+			memcpy(buffer, image.data() + offset, size);
+			if (bytes_read) *bytes_read = size;
+			return true;
+		}
+
+		bool Write(const void *, const void *, size_t) override { return false; }
+
+		bool QueryRegion(const void *address, ProcUtil::MemoryRegion &out) override
+		{
+			const uint8_t *remote = (const uint8_t *)address;
+			if (remote < Base())
+			{
+				out = { nullptr, (size_t)(Base() - (const uint8_t *)nullptr), false };
+				return true;
+			}
+
+			for (const auto &region : regions)
+			{
+				if (remote < region.base + region.size)
+				{
+					out = region;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		std::vector<ProcUtil::ModuleInfo> GetModules() override { return {}; }
+		bool GetMainModule(ProcUtil::ModuleInfo &) override { return false; }
+	};
+
+	void BuildLayout(FakeMemory &memory, std::mt19937 &rng)
+	{
+		auto random = [&rng](size_t limit) { return (size_t)(rng() % limit); };
+
+		const size_t pages = 256 + random(2048); // up to 9 MB, several 2 MB chunks
+		memory.image.resize(pages * PageSize);
+		for (size_t i = 0; i < memory.image.size(); i += 4)
+		{
+			const uint32_t values = (uint32_t)rng() & 0x03030303; // a small alphabet, four bytes at a time
+			memcpy(memory.image.data() + i, &values, 4);
+		}
+
+		for (size_t page = 0; page < pages;)
+		{
+			// mostly big readable regions, a few small holes
+			const size_t length = (std::min)(pages - page, random(4) == 0 ? 1 + random(4) : 16 + random(1024));
+			const bool readable = random(5) != 0;
+			memory.regions.push_back({ memory.Base() + page * PageSize, length * PageSize, readable });
+
+			if (readable && random(3) == 0)
+			{
+				const size_t first = page + random(length);
+				memory.failing.push_back({ first * PageSize, (first + 1 + random(3)) * PageSize });
+			}
+
+			page += length;
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 rng(1337);
+	auto random = [&rng](size_t limit) { return (size_t)(rng() % limit); };
+
+	ThreadPool pools[] = { ThreadPool(0), ThreadPool(1), ThreadPool(3) };
+	int failures = 0;
+	int matched = 0;
+	const int iterations = 150;
+
+	for (int iteration = 0; iteration < iterations && failures < 10; iteration++)
+	{
+		FakeMemory memory;
+		BuildLayout(memory, rng);
+
+		const size_t length = 4 + random(12);
+		std::string aob(length, '\0');
+		for (auto &character : aob) character = (char)(4 + random(250)); // never in the filler
+		const std::string mask(length, 'x');
+
+		// plant matches near region boundaries, chunk boundaries and failing pages, where the two scans could disagree
+		std::vector<size_t> offsets;
+		for (const auto &region : memory.regions)
+			offsets.push_back(region.base - memory.Base());
+		for (const auto &range : memory.failing)
+		{
+			offsets.push_back(range.start);
+			offsets.push_back(range.end);
+		}
+		for (size_t offset = 0; offset < memory.image.size(); offset += 2 * 1024 * 1024)
+			offsets.push_back(offset);
+
+		for (int planted = 0; planted < 6; planted++)
+		{
+			const size_t around = offsets[random(offsets.size())];
+			const size_t offset = around + random(2 * length) - length;
+			if (offset < memory.image.size() - length)
+				memcpy(memory.image.data() + offset, aob.data(), length);
+		}
+
+		const uint8_t *start = memory.Base() + random(PageSize);
+
+		// the region map merges neighbours as it learns them, so a cold map answers differently than a warm one: both scans
+		// get the warm one
+		ProcUtil::MemoryRegion region;
+		for (const uint8_t *i = start; memory.GetRegions().Find(i, region); i = region.base + region.size);
+
+		ProcUtil::PipelinedReads = (iteration % 2) == 0;
+		void *expected = ProcUtil::ScanProcess(memory, aob.data(), mask.c_str(), start);
+
+		for (auto &pool : pools)
+		{
+			void *found = ProcUtil::ScanProcessParallel(memory, aob.data(), mask.c_str(), pool, start);
+			if (found == expected)
+				continue;
+
+			failures++;
+			printf("FAIL iteration %d, %zu threads: expected %p, found %p (%zu regions, %zu failing ranges)\n", iteration, pool.GetThreadCount(), expected, found, memory.regions.size(), memory.failing.size());
+		}
+
+		if (expected)
+			matched++;
+	}
+
+	if (failures)
+		return 1;
+
+	printf("%d layouts agreed (%d with a match)\n", iterations, matched);
+	return 0;
+}
\ No newline at end of file
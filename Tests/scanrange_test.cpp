@@ -0,0 +1,91 @@
+// ScanProcessAll over this process' own memory with a callback that throws, serial and pipelined: the exception reaches the
+// caller (instead of terminating on the reader thread's destructor) and scanning keeps working afterwards.
+
+#include "linuxmemory.h"
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <unistd.h>
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} \
+	while (0)
+
+namespace
+{
+	int failures = 0;
+}
+
+int main()
+{
+	ProcUtil::LinuxMemorySource self(getpid());
+
+	// several 2 MB chunks, with a match in the first, one in the middle and one in the last
+	std::vector<uint8_t> memory(9 * 1024 * 1024, 0x90);
+	const char pattern[] = "\x48\x8B\x05\x11\x22\x33\x44\xC3";
+	const size_t offsets[] = { 0x1000, 4 * 1024 * 1024 + 3, memory.size() - 0x100 };
+	for (size_t offset : offsets)
+		memcpy(memory.data() + offset, pattern, 8);
+
+	const uint8_t *start = memory.data();
+	const uint8_t *end = memory.data() + memory.size();
+
+	for (bool pipelined : { false, true })
+	{
+		ProcUtil::PipelinedReads = pipelined;
+
+		for (size_t throw_at = 0; throw_at < 3; throw_at++)
+		{
+			for (int repeat = 0; repeat < 20; repeat++)
+			{
+				size_t seen = 0;
+				bool thrown = false;
+
+				try
+				{
+					ProcUtil::ScanProcessAll(self, pattern, "xxxxxxxx", [&](const uint8_t *remote, const uint8_t *)
+					{
+						CHECK(remote == start + offsets[seen]);
+						if (seen++ == throw_at)
+							throw std::bad_alloc();
+
+						return true;
+					}, start, end);
+				}
+				catch (const std::bad_alloc &)
+				{
+					thrown = true;
+				}
+
+				CHECK(thrown);
+				CHECK(seen == throw_at + 1);
+			}
+		}
+
+		// and a scan that runs to the end still sees every match
+		size_t seen = 0;
+		CHECK(ProcUtil::ScanProcessAll(self, pattern, "xxxxxxxx", [&](const uint8_t *remote, const uint8_t *)
+		{
+			CHECK(seen < 3 && remote == start + offsets[seen]);
+			seen++;
+			return true;
+		}, start, end));
+		CHECK(seen == 3);
+	}
+
+	if (failures)
+		return 1;
+
+	printf("Throwing callbacks passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+// Differential test of the sigscan strategies: scalar, Horspool and SIMD on every instruction set the cpu supports have to
+// report exactly the matches the plain compare loop finds, on random buffers and masks, matches at the end included.
+
+#include "sigscan.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Variant
+	{
+		const char *name;
+		sigscan::strategy method;
+		sigscan::isa simd_isa;
+	};
+
+	// Every offset a full pattern fits at, with the bounds sigscan::scan has always had: [start, end - length)
+	std::vector<size_t> FindReference(const std::vector<uint8_t> &buffer, const std::string &aob, const std::string &mask)
+	{
+		std::vector<size_t> result;
+
+		for (size_t i = 0; i + mask.size() < buffer.size(); i++)
+		{
+			if (sigscan::compare((const char *)buffer.data() + i, aob.data(), mask.c_str()))
+				result.push_back(i);
+		}
+
+		return result;
+	}
+
+	std::vector<size_t> FindAll(const sigscan::pattern &pattern, const std::vector<uint8_t> &buffer)
+	{
+		std::vector<size_t> result;
+		const uintptr_t start = (uintptr_t)buffer.data();
+
+		sigscan::scan_all(pattern, start, start + buffer.size(), [&](uint8_t *location)
+		{
+			result.push_back((uintptr_t)location - start);
+			return true;
+		});
+
+		return result;
+	}
+
+	void PrintOffsets(const char *label, const std::vector<size_t> &offsets)
+	{
+		printf("  %s:", label);
+		for (size_t offset : offsets) printf(" %zu", offset);
+		printf("\n");
+	}
+}
+
+int main()
+{
+	std::vector<Variant> variants = {
+		{ "scalar", sigscan::strategy::scalar, sigscan::isa::scalar },
+		{ "horspool", sigscan::strategy::horspool, sigscan::isa::scalar },
+		{ "automatic", sigscan::strategy::automatic, sigscan::detect_isa() }
+	};
+
+	const sigscan::isa supported = sigscan::detect_isa();
+	for (sigscan::isa simd_isa : { sigscan::isa::sse2, sigscan::isa::avx2, sigscan::isa::avx512 })
+	{
+		if (simd_isa <= supported)
+			variants.push_back({ sigscan::isa_name(simd_isa), sigscan::strategy::simd, simd_isa });
+	}
+
+	printf("Strategies:");
+	for (const auto &variant : variants) printf(" %s", variant.name);
+	printf("\n");
+
+	std::mt19937 rng(1337);
+	auto random = [&rng](size_t limit) { return (size_t)(rng() % limit); };
+
+	const int iterations = 20000;
+	int failures = 0;
+
+	for (int iteration = 0; iteration < iterations && failures < 10; iteration++)
+	{
+		// small alphabets make partial matches (and false SIMD candidates) common
+		static const unsigned alphabets[] = { 2, 4, 16, 256 };
+		const unsigned alphabet = alphabets[random(4)];
+
+		std::vector<uint8_t> buffer(random(8) == 0 ? 1024 + random(4096) : random(400));
+		for (auto &value : buffer) value = (uint8_t)random(alphabet);
+
+		const size_t length = 1 + random(48);
+		static const unsigned fixed_percent[] = { 0, 30, 70, 100 };
+		const unsigned fixed = fixed_percent[random(4)];
+
+		std::string mask(length, '?');
+		for (auto &character : mask)
+		{
+			if (random(100) < fixed) character = 'x';
+		}
+
+		std::string aob(length, '\0');
+		for (auto &character : aob) character = (char)random(alphabet);
+
+		if (buffer.size() > length)
+		{
+			// a sure match somewhere, one at the last offset scanned and one just past it, which must not be reported
+			if (random(2) == 0)
+				memcpy(&aob[0], buffer.data() + random(buffer.size() - length), length);
+
+			memcpy(buffer.data() + buffer.size() - length - 1, aob.data(), length);
+			if (random(2) == 0)
+				memcpy(buffer.data() + buffer.size() - length, aob.data(), length);
+		}
+
+		const auto expected = FindReference(buffer, aob, mask);
+
+		for (const auto &variant : variants)
+		{
+			sigscan::pattern pattern(aob.data(), mask.c_str(), variant.method);
+			pattern.simd_isa = variant.simd_isa;
+
+			const auto found = FindAll(pattern, buffer);
+			if (found == expected)
+				continue;
+
+			const char *ran_as = pattern.method == sigscan::strategy::simd ? sigscan::isa_name(pattern.simd_isa) : sigscan::strategy_name(pattern.method);
+
+			failures++;
+			printf("FAIL %s (ran as %s): iteration %d, buffer %zu bytes, mask %s\n", variant.name, ran_as, iteration, buffer.size(), mask.c_str());
+			PrintOffsets("expected", expected);
+			PrintOffsets("found", found);
+		}
+	}
+
+	if (failures)
+		return 1;
+
+	printf("%d random cases matched the reference\n", iterations);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+// ModuleSnapshot over a fake process: one read per chunk, reads and matches that straddle a chunk boundary, an unreadable hole
+// in the middle of the module, and invalidation followed by a refill that reuses the snapshot.
+
+#include "snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} \
+	while (0)
+
+namespace
+{
+	int failures = 0;
+
+	const size_t PageSize = ProcUtil::ModuleSnapshot::PageSize;
+	const size_t ChunkSize = ProcUtil::ModuleSnapshot::ChunkPages * PageSize;
+
+	// A module of `size` bytes at a made-up address, with [hole_start, hole_end) unreadable
+	class FakeMemory : public ProcUtil::MemorySource
+	{
+	public:
+		FakeMemory(size_t size, size_t hole_start, size_t hole_end)
+			: image(size), hole_start(hole_start), hole_end(hole_end)
+		{
+			std::mt19937 rng(1337);
+			for (auto &value : image) value = (uint8_t)rng();
+		}
+
+		std::vector<uint8_t> image;
+		size_t reads = 0;
+
+		const uint8_t *Base() const { return (const uint8_t *)0x10000000; }
+
+		const void *GetTag() const override { return this; }
+		bool Is64Bit() override { return true; }
+
+		bool Read(const void *address, void *buffer, size_t size, size_t *bytes_read = nullptr) override
+		{
+			reads++;
+			if (bytes_read) *bytes_read = 0;
+
+			const size_t offset = (const uint8_t *)address - Base();
+			if ((const uint8_t *)address < Base() || offset + size > image.size())
+				return false;
+
+			if (offset < hole_end && offset + size > hole_start)
+				return false;
+
+			memcpy(buffer, image.data() + offset, size);
+			if (bytes_read) *bytes_read = size;
+			return true;
+		}
+
+		bool Write(const void *, const void *, size_t) override { return false; }
+
+		bool QueryRegion(const void *address, ProcUtil::MemoryRegion &out) override
+		{
+			const uint8_t *i = (const uint8_t *)address;
+			const uint8_t *end = Base() + image.size();
+
+			if (i < Base())
+				out = { nullptr, (size_t)(Base() - (const uint8_t *)nullptr), false };
+			else if (i < Base() + hole_start)
+				out = { Base(), hole_start, true };
+			else if (i < Base() + hole_end)
+				out = { Base() + hole_start, hole_end - hole_start, false };
+			else if (i < end)
+				out = { Base() + hole_end, image.size() - hole_end, true };
+			else
+				return false;
+
+			return true;
+		}
+
+		std::vector<ProcUtil::ModuleInfo> GetModules() override { return { GetModule() }; }
+		bool GetMainModule(ProcUtil::ModuleInfo &out) override { out = GetModule(); return true; }
+
+	private:
+		ProcUtil::ModuleInfo GetModule() const { return { "RobloxPlayerBeta.exe", (void *)Base(), image.size() }; }
+
+		size_t hole_start;
+		size_t hole_end;
+	};
+
+	std::vector<size_t> FindAll(ProcUtil::ModuleSnapshot &snapshot, const uint8_t *base, const char *aob, const char *mask)
+	{
+		std::vector<size_t> result;
+
+		snapshot.ScanAll(aob, mask, [&](const uint8_t *address, const uint8_t *)
+		{
+			result.push_back(address - base);
+			return true;
+		}, nullptr, (const uint8_t *)UINTPTR_MAX);
+
+		return result;
+	}
+}
+
+int main()
+{
+	// two and a half chunks, no PE headers so the whole module counts as code
+	const size_t size = ChunkSize * 2 + ChunkSize / 2;
+
+	{
+		FakeMemory memory(size, size, size);
+		ProcUtil::ModuleInfo module;
+		memory.GetMainModule(module);
+
+		ProcUtil::ModuleSnapshot snapshot(memory, module);
+		CHECK(!snapshot.HasHeaders());
+
+		snapshot.ResetStats();
+		snapshot.Fill();
+		CHECK(snapshot.GetStats().syscalls == 3); // the header page was read already, so the first chunk's run is one page short
+		CHECK(snapshot.GetStats().bytes_read == size - PageSize);
+
+		// across the first chunk boundary, served from a copy
+		const uint8_t *base = memory.Base();
+		const uint8_t *local = snapshot.Get(base + ChunkSize - 8, 16);
+		CHECK(local && memcmp(local, memory.image.data() + ChunkSize - 8, 16) == 0);
+
+		// longer than a chunk
+		local = snapshot.Get(base + 100, ChunkSize + 200);
+		CHECK(local && memcmp(local, memory.image.data() + 100, ChunkSize + 200) == 0);
+
+		// within one chunk, no copy needed and no further reads
+		const size_t reads = memory.reads;
+		local = snapshot.Get(base + ChunkSize + 0x20, 0x100);
+		CHECK(local && memcmp(local, memory.image.data() + ChunkSize + 0x20, 0x100) == 0);
+		CHECK(memory.reads == reads);
+
+		CHECK(!snapshot.Get(base + size - 4, 8));
+
+		// a match straddling the second chunk boundary and one inside a chunk
+		const char pattern[] = "\xDE\xAD\xBE\xEF\x13\x37\xC0\xDE";
+		memcpy(memory.image.data() + ChunkSize * 2 - 3, pattern, 8);
+		memcpy(memory.image.data() + 0x5000, pattern, 8);
+
+		snapshot.InvalidateAll();
+		snapshot.ResetStats();
+		snapshot.Fill();
+		CHECK(snapshot.GetStats().syscalls == 3);
+		CHECK(snapshot.GetStats().bytes_read == size);
+
+		const auto found = FindAll(snapshot, base, pattern, "xxxxxxxx");
+		CHECK(found.size() == 2 && found[0] == 0x5000 && found[1] == ChunkSize * 2 - 3);
+
+		// pages stay as loaded until invalidated
+		memory.image[0x5000] = 0;
+		CHECK(snapshot.Get(base + 0x5000, 1)[0] == 0xDE);
+
+		snapshot.Invalidate(base + 0x5000, 1);
+		CHECK(snapshot.Get(base + 0x5000, 1)[0] == 0);
+		CHECK(FindAll(snapshot, base, pattern, "xxxxxxxx").size() == 1);
+	}
+
+	{
+		// unreadable pages in the middle of the second chunk
+		const size_t hole_start = ChunkSize + 0x3000, hole_end = ChunkSize + 0x8000;
+		FakeMemory memory(size, hole_start, hole_end);
+		ProcUtil::ModuleInfo module;
+		memory.GetMainModule(module);
+
+		const char pattern[] = "\x0F\x1E\xFA\x55\x48\x89\xE5";
+		memcpy(memory.image.data() + hole_start - 0x10, pattern, 7);
+		memcpy(memory.image.data() + hole_end + 0x10, pattern, 7);
+
+		ProcUtil::ModuleSnapshot snapshot(memory, module);
+		snapshot.Fill();
+
+		const uint8_t *base = memory.Base();
+		CHECK(!snapshot.Get(base + hole_start, 1));
+		CHECK(!snapshot.Get(base + hole_start - 4, 8));
+		CHECK(snapshot.Get(base + hole_start - 4, 4));
+
+		const uint8_t *local = snapshot.Get(base + hole_end, 0x2000);
+		CHECK(local && memcmp(local, memory.image.data() + hole_end, 0x2000) == 0);
+
+		const auto found = FindAll(snapshot, base, pattern, "xxxxxxx");
+		CHECK(found.size() == 2 && found[0] == hole_start - 0x10 && found[1] == hole_end + 0x10);
+	}
+
+	if (failures)
+		return 1;
+
+	printf("Module snapshot passed\n");
+	return 0;
+}
\ No newline at end of file
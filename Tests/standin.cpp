@@ -0,0 +1,163 @@
+// Stand-in for a Roblox client running under Wine, for the end-to-end attach test.
+//
+//   standin --image <path>   writes a synthetic 64-bit client image to <path>
+//   standin <path>           maps <path> under the argv[0] Wine gives RobloxPlayerBeta.exe and waits up to 10 seconds for
+//                            the unlocker to change the TaskScheduler frame delay; exits 0 once it did
+//
+// The image has the 64-bit TaskScheduler signature near the end of .text, its call resolves to a getter that loads the
+// scheduler pointer from .data, and the stand-in points that at a heap TaskScheduler with a 1/60 frame delay at +0x150.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+namespace
+{
+	const uint32_t TextRva = 0x1000;
+	const uint32_t TextSize = 12 * 1024 * 1024;
+	const uint32_t DataRva = TextRva + TextSize;
+	const uint32_t DataSize = 0x1000;
+	const uint32_t SchedulerPointerRva = DataRva + 0x10;
+	const size_t FrameDelayOffset = 0x150;
+
+	const char *const WineArgv0 = "C:\\Roblox\\RobloxPlayerBeta.exe";
+
+	template <typename T>
+	void Put(std::vector<uint8_t> &image, size_t offset, T value)
+	{
+		memcpy(image.data() + offset, &value, sizeof(value));
+	}
+
+	void PutSection(std::vector<uint8_t> &image, size_t offset, const char *name, uint32_t rva, uint32_t size, uint32_t characteristics)
+	{
+		memcpy(image.data() + offset, name, strlen(name));
+		Put<uint32_t>(image, offset + 8, size); // VirtualSize
+		Put<uint32_t>(image, offset + 12, rva);
+		Put<uint32_t>(image, offset + 16, size); // SizeOfRawData
+		Put<uint32_t>(image, offset + 20, rva); // PointerToRawData: the file is laid out like the image
+		Put<uint32_t>(image, offset + 36, characteristics);
+	}
+
+	bool WriteImage(const char *path)
+	{
+		std::vector<uint8_t> image(TextRva + TextSize + DataSize);
+
+		const size_t nt = 0x80;
+		image[0] = 'M'; image[1] = 'Z';
+		Put<uint32_t>(image, 0x3C, nt);
+		memcpy(image.data() + nt, "PE\0\0", 4);
+
+		const size_t file_header = nt + 4;
+		Put<uint16_t>(image, file_header, 0x8664); // Machine
+		Put<uint16_t>(image, file_header + 2, 2); // NumberOfSections
+		Put<uint32_t>(image, file_header + 4, 0x5EED); // TimeDateStamp
+		Put<uint16_t>(image, file_header + 16, 240); // SizeOfOptionalHeader
+		Put<uint16_t>(image, file_header + 18, 0x22); // Characteristics
+
+		const size_t optional_header = file_header + 20;
+		Put<uint16_t>(image, optional_header, 0x20B); // PE32+
+		Put<uint64_t>(image, optional_header + 24, 0x140000000); // ImageBase
+		Put<uint32_t>(image, optional_header + 56, DataRva + DataSize); // SizeOfImage
+		Put<uint32_t>(image, optional_header + 60, TextRva); // SizeOfHeaders
+
+		const size_t sections = optional_header + 240;
+		PutSection(image, sections, ".text", TextRva, TextSize, 0x60000020);
+		PutSection(image, sections + 40, ".data", DataRva, DataSize, 0xC0000040);
+
+		// random code, so the scanners get realistic false candidates
+		std::mt19937 rng(7);
+		for (size_t i = TextRva; i < TextRva + TextSize; i += sizeof(uint32_t))
+			Put<uint32_t>(image, i, (uint32_t)rng());
+
+		static const uint8_t signature[] = {
+			0x40, 0x53, 0x48, 0x83, 0xEC, 0x20, 0x0F, 0xB6, 0xD9, 0xE8, 0x00, 0x00, 0x00, 0x00,
+			0x86, 0x58, 0x04, 0x48, 0x83, 0xC4, 0x20, 0x5B, 0xC3
+		};
+		const uint32_t signature_rva = TextRva + TextSize - 0x10000;
+		const uint32_t getter_rva = signature_rva + 0x1000;
+		memcpy(image.data() + signature_rva, signature, sizeof(signature));
+		Put<int32_t>(image, signature_rva + 10, (int32_t)(getter_rva - (signature_rva + 14))); // call rel32
+
+		static const uint8_t getter[] = { 0x48, 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00, 0x48, 0x83, 0xC4, 0x28 }; // mov rax, [rip+rel32]
+		const uint32_t load_rva = getter_rva + 0x20;
+		memcpy(image.data() + load_rva, getter, sizeof(getter));
+		Put<int32_t>(image, load_rva + 3, (int32_t)(SchedulerPointerRva - (load_rva + 7)));
+
+		FILE *file = fopen(path, "wb");
+		if (!file)
+			return false;
+
+		const bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+		return fclose(file) == 0 && written;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 3 && strcmp(argv[1], "--image") == 0)
+		return WriteImage(argv[2]) ? 0 : 1;
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s --image <path> | %s <path>\n", argv[0], argv[0]);
+		return 2;
+	}
+
+	// Wine puts the Windows path in argv[0], which is how the front-end finds clients
+	if (strcmp(argv[0], WineArgv0) != 0)
+	{
+		char *const args[] = { (char *)WineArgv0, argv[1], nullptr };
+		execv("/proc/self/exe", args);
+		perror("execv");
+		return 2;
+	}
+
+	// the unlocker isn't our parent, let it read and write our memory where Yama restricts ptrace
+	prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY, 0, 0, 0);
+
+	const int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		perror(argv[1]);
+		return 2;
+	}
+
+	const size_t size = (size_t)lseek(fd, 0, SEEK_END);
+	auto base = (uint8_t *)mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		perror("mmap");
+		return 2;
+	}
+
+	static double scheduler[0x400 / sizeof(double)];
+	volatile double *frame_delay = scheduler + FrameDelayOffset / sizeof(double);
+	*frame_delay = 1.0 / 60.0;
+	const void *scheduler_pointer = scheduler;
+	memcpy(base + SchedulerPointerRva, &scheduler_pointer, sizeof(scheduler_pointer));
+
+	fprintf(stderr, "standin %d: image at %p\n", (int)getpid(), (void *)base);
+
+	for (int i = 0; i < 50; i++)
+	{
+		usleep(200 * 1000);
+
+		const double value = *frame_delay;
+		if (value != 1.0 / 60.0)
+		{
+			printf("frame delay now %f (%.1f fps)\n", value, 1.0 / value);
+			return 0;
+		}
+	}
+
+	printf("frame delay unchanged\n");
+	return 1;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+// A span left open across Stop and a new Start belongs to neither trace: it isn't written to the second file (where its
+// start would be measured from the wrong origin), while spans and instants of the second trace are.
+
+#include "trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} \
+	while (0)
+
+namespace
+{
+	int failures = 0;
+
+	std::string ReadFile(const std::filesystem::path &path)
+	{
+		std::ifstream stream(path);
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		return contents.str();
+	}
+}
+
+int main()
+{
+	const auto directory = std::filesystem::temp_directory_path();
+	const auto first_path = directory / "rfu_trace_test_1.json";
+	const auto second_path = directory / "rfu_trace_test_2.json";
+
+	CHECK(Trace::Start(first_path));
+
+	{
+		Trace::Span across("across", "test");
+		Trace::Span first("first", "test");
+		first.Stop();
+
+		Trace::Stop();
+		CHECK(Trace::Start(second_path));
+
+		Trace::Span second("second", "test");
+		Trace::Instant("instant", "test");
+	}
+
+	Trace::Stop();
+
+	const std::string first = ReadFile(first_path);
+	const std::string second = ReadFile(second_path);
+
+	CHECK(first.find("\"name\":\"first\"") != std::string::npos);
+	CHECK(first.find("\"name\":\"across\"") == std::string::npos); // still open when the first trace stopped
+	CHECK(second.find("\"name\":\"across\"") == std::string::npos);
+	CHECK(second.find("\"name\":\"second\"") != std::string::npos);
+	CHECK(second.find("\"name\":\"instant\"") != std::string::npos);
+	CHECK(second.find("\"name\":\"first\"") == std::string::npos);
+
+	std::filesystem::remove(first_path);
+	std::filesystem::remove(second_path);
+
+	if (failures)
+		return 1;
+
+	printf("Trace generations passed\n");
+	return 0;
+}
\ No newline at end of file